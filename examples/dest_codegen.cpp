@@ -0,0 +1,315 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+#include <dest/dest.h>
+#include <dest/io/dest_io_generated.h>
+#include <dest/io/matrix_io.h>
+#include <tclap/CmdLine.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstdio>
+#include <cmath>
+#include <cctype>
+
+/**
+    Format float as C++ literal that reads back to the identical value.
+*/
+std::string floatLiteral(float v) {
+    if (std::isnan(v))
+        return "std::numeric_limits<float>::quiet_NaN()";
+    if (std::isinf(v))
+        return v > 0.f ? "std::numeric_limits<float>::infinity()" : "-std::numeric_limits<float>::infinity()";
+
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", v);
+    std::string s(buf);
+    if (s.find_first_of(".e") == std::string::npos)
+        s += ".";
+    return s + "f";
+}
+
+/**
+    Write values as comma separated list, eight values per line.
+*/
+template<class Format>
+void writeValues(std::ostream &os, int count, const std::string &indent, Format format) {
+    for (int i = 0; i < count; ++i) {
+        os << ((i % 8 == 0) ? "\n" + indent : std::string(" ")) << format(i) << ((i + 1 < count) ? "," : "");
+    }
+}
+
+void writeFloatArray(std::ostream &os, const std::string &name, const float *values, int count) {
+    os << "        const float " << name << "[" << count << "] = {";
+    writeValues(os, count, "            ", [values](int i) { return floatLiteral(values[i]); });
+    os << "\n        };\n\n";
+}
+
+void writeIntArray(std::ostream &os, const std::string &name, const int *values, int count) {
+    os << "        const int " << name << "[" << count << "] = {";
+    writeValues(os, count, "            ", [values](int i) { return std::to_string(values[i]); });
+    os << "\n        };\n\n";
+}
+
+/**
+    Emit the subtree rooted at node as nested split tests selecting a leaf residual.
+*/
+void writeNode(std::ostream &os, const dest::core::Tree &t, int node, int depth, const std::string &leavesName, std::vector<dest::core::ShapeResidual> &leaves) {
+    const std::string indent(12 + depth * 4, ' ');
+
+    int idx1, idx2;
+    float threshold;
+    if (t.nodeSplit(node, idx1, idx2, threshold)) {
+        os << indent << "if (p[" << idx1 << "] - p[" << idx2 << "] > " << floatLiteral(threshold) << ") {\n";
+        writeNode(os, t, 2 * node + 1, depth + 1, leavesName, leaves);
+        os << indent << "} else {\n";
+        writeNode(os, t, 2 * node + 2, depth + 1, leavesName, leaves);
+        os << indent << "}\n";
+    } else {
+        os << indent << "l = " << leavesName << "[" << leaves.size() << "];\n";
+        leaves.push_back(t.nodeMean(node));
+    }
+}
+
+/**
+    Decode leaf residuals shared by all trees of a regressor, if any. Same as Regressor::load.
+*/
+Eigen::MatrixXf decodeLeaves(const dest::io::Regressor &r) {
+    Eigen::MatrixXf leaves;
+    if (r.quantizedLeaves()) {
+        dest::io::fromFbs(*r.quantizedLeaves(), leaves);
+    } else if (r.leafCoefficients()) {
+        dest::io::fromFbs(*r.leafCoefficients(), leaves);
+    }
+
+    if (r.leafBasis()) {
+        Eigen::MatrixXf basis;
+        dest::io::fromFbs(*r.leafBasis(), basis);
+        leaves = basis * leaves;
+    }
+    return leaves;
+}
+
+/**
+    Emit tables and forest function of a single cascade stage.
+*/
+void writeStage(std::ostream &os, const dest::io::Regressor &r, int stage, int numLandmarks) {
+    const std::string prefix = "stage" + std::to_string(stage);
+
+    dest::core::PixelCoordinates offsets;
+    Eigen::VectorXi anchorIds;
+    dest::core::ShapeResidual meanResidual;
+    dest::core::Shape meanShape;
+    dest::io::fromFbs(*r.pixelCoordinates(), offsets);
+    dest::io::fromFbs(*r.closestLandmarks(), anchorIds);
+    dest::io::fromFbs(*r.meanShapeResidual(), meanResidual);
+    dest::io::fromFbs(*r.meanShape(), meanShape);
+
+    // Same as Regressor::data::centerMeanShape
+    const Eigen::Vector2f center = meanShape.rowwise().mean();
+    const dest::core::Shape centered = meanShape.colwise() - center;
+    const float squaredNorm = centered.squaredNorm();
+
+    const int numCoords = static_cast<int>(offsets.cols());
+    const float learningRate = r.learningRate();
+    const Eigen::MatrixXf sharedLeaves = decodeLeaves(r);
+
+    os << "        // Stage " << stage << "\n\n";
+    writeFloatArray(os, prefix + "MeanResidual", meanResidual.data(), 2 * numLandmarks);
+    writeFloatArray(os, prefix + "CenteredMeanShape", centered.data(), 2 * numLandmarks);
+    writeFloatArray(os, prefix + "Offsets", offsets.data(), 2 * numCoords);
+    writeIntArray(os, prefix + "AnchorIds", anchorIds.data(), numCoords);
+
+    // Trees are emitted first to enumerate their leaves.
+    std::vector<dest::core::ShapeResidual> leaves;
+    std::ostringstream trees;
+    for (flatbuffers::uoffset_t i = 0; i < r.forest()->size(); ++i) {
+        dest::core::Tree t;
+        t.load(*r.forest()->Get(i), sharedLeaves.size() > 0 ? &sharedLeaves : 0);
+
+        trees << "            // Tree " << i << "\n";
+        writeNode(trees, t, 0, 0, prefix + "Leaves", leaves);
+        trees << "            addLeaf(l, r);\n";
+    }
+
+    // Leaf residuals are pre-multiplied by the learning rate as in Forest::build.
+    os << "        const float " << prefix << "Leaves[" << std::max<size_t>(leaves.size(), 1) << "][" << 2 * numLandmarks << "] = {\n";
+    for (size_t i = 0; i < leaves.size(); ++i) {
+        const Eigen::VectorXf l = Eigen::Map<const Eigen::VectorXf>(leaves[i].data(), leaves[i].size()) * learningRate;
+        os << "            {";
+        writeValues(os, static_cast<int>(l.size()), "                ", [&l](int k) { return floatLiteral(l(k)); });
+        os << "\n            }" << ((i + 1 < leaves.size()) ? "," : "") << "\n";
+    }
+    os << "        };\n\n";
+
+    os << "        void " << prefix << "Forest(const float *p, float *r) {\n";
+    os << "            const float *l;\n";
+    os << trees.str();
+    os << "            (void)p; (void)l;\n";
+    os << "        }\n\n";
+
+    os << "        const float " << prefix << "Center[2] = { " << floatLiteral(center(0)) << ", " << floatLiteral(center(1)) << " };\n";
+    os << "        const float " << prefix << "SquaredNorm = " << floatLiteral(squaredNorm) << ";\n";
+    os << "        const int " << prefix << "NumCoords = " << numCoords << ";\n\n";
+}
+
+/**
+    Convert a trained tracker to C++ source code.
+
+    Emits a header and a source file defining a predict function with the contract of
+    dest::core::Tracker::predict. Split tests become nested comparisons and all model
+    parameters become constant arrays, so no model file needs to be parsed or loaded at
+    runtime and the compiler sees the fixed model.
+
+    Predictions match the tracker loaded with float32 leaves and tree walk evaluation.
+    Quantized or compressed leaves are expanded to float.
+*/
+int main(int argc, char **argv)
+{
+    struct {
+        std::string tracker;
+        std::string output;
+        std::string ns;
+    } opts;
+
+    try {
+        TCLAP::CmdLine cmd("Generate C++ source code from a trained tracker.", ' ', "0.9");
+        TCLAP::ValueArg<std::string> outputArg("o", "output", "Base path of generated header (.h) and source (.cpp) files", false, "dest_model", "path", cmd);
+        TCLAP::ValueArg<std::string> namespaceArg("n", "namespace", "Namespace of generated predict function", false, "dest_model", "string", cmd);
+        TCLAP::UnlabeledValueArg<std::string> trackerArg("tracker", "Trained tracker to convert", true, "dest.bin", "file", cmd);
+
+        cmd.parse(argc, argv);
+
+        opts.tracker = trackerArg.getValue();
+        opts.output = outputArg.getValue();
+        opts.ns = namespaceArg.getValue();
+    }
+    catch (TCLAP::ArgException &e) {
+        std::cerr << "Error: " << e.error() << " for arg " << e.argId() << std::endl;
+        return -1;
+    }
+
+    std::ifstream ifs(opts.tracker, std::ifstream::binary);
+    std::string buf;
+    if (ifs.is_open()) {
+        buf.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    flatbuffers::Verifier v(reinterpret_cast<const uint8_t*>(buf.data()), buf.size());
+    if (buf.empty() || !dest::io::VerifyTrackerBuffer(v)) {
+        std::cerr << "Failed to load tracker." << std::endl;
+        return -1;
+    }
+
+    const dest::io::Tracker &t = *dest::io::GetTracker(buf.data());
+
+    dest::core::Shape meanShape;
+    dest::io::fromFbs(*t.meanShape(), meanShape);
+    const int numLandmarks = static_cast<int>(meanShape.cols());
+    const int numStages = static_cast<int>(t.cascade()->size());
+
+    const std::string headerName = opts.output.substr(opts.output.find_last_of("/\\") + 1) + ".h";
+    std::string guard = opts.ns + "_" + headerName;
+    for (size_t i = 0; i < guard.size(); ++i) {
+        guard[i] = std::isalnum(static_cast<unsigned char>(guard[i])) ? static_cast<char>(std::toupper(static_cast<unsigned char>(guard[i]))) : '_';
+    }
+
+    std::ofstream h(opts.output + ".h");
+    h << "// Generated by dest_codegen from " << opts.tracker << ". Do not edit.\n\n";
+    h << "#ifndef " << guard << "\n#define " << guard << "\n\n";
+    h << "#include <dest/core/image.h>\n#include <dest/core/shape.h>\n\n";
+    h << "namespace " << opts.ns << " {\n\n";
+    h << "    /** Number of landmarks predicted. */\n";
+    h << "    const int NumLandmarks = " << numLandmarks << ";\n\n";
+    h << "    /**\n";
+    h << "        Align shape with image. Same as dest::core::Tracker::predict of the source tracker.\n\n";
+    h << "        \\param img Image to align shape with.\n";
+    h << "        \\param shapeToImage Transform from normalized shape space to image space.\n";
+    h << "        \\returns Shape in image space.\n";
+    h << "    */\n";
+    h << "    dest::core::Shape predict(const Eigen::Ref<const dest::core::Image> &img, const dest::core::ShapeTransform &shapeToImage);\n\n";
+    h << "}\n\n#endif\n";
+
+    std::ofstream s(opts.output + ".cpp");
+    s << "// Generated by dest_codegen from " << opts.tracker << ". Do not edit.\n\n";
+    s << "#include \"" << headerName << "\"\n#include <limits>\n\n";
+    s << "namespace " << opts.ns << " {\n\n";
+    s << "    namespace {\n\n";
+    s << "        typedef Eigen::Matrix<float, 2 * NumLandmarks, 1> Residual;\n\n";
+    s << "        inline void addLeaf(const float *l, float *r) {\n";
+    s << "            Eigen::Map<Residual>(r) += Eigen::Map<const Residual>(l);\n";
+    s << "        }\n\n";
+    writeFloatArray(s, "meanShape", meanShape.data(), 2 * numLandmarks);
+
+    for (int i = 0; i < numStages; ++i) {
+        writeStage(s, *t.cascade()->Get(i), i, numLandmarks);
+    }
+
+    s << "        struct Stage {\n";
+    s << "            const float *meanResidual;\n";
+    s << "            const float *centeredMeanShape;\n";
+    s << "            const float *center;\n";
+    s << "            float squaredNorm;\n";
+    s << "            const float *offsets;\n";
+    s << "            const int *anchorIds;\n";
+    s << "            int numCoords;\n";
+    s << "            void (*forest)(const float *p, float *r);\n";
+    s << "        };\n\n";
+    s << "        const Stage stages[" << std::max(numStages, 1) << "] = {\n";
+    for (int i = 0; i < numStages; ++i) {
+        const std::string p = "stage" + std::to_string(i);
+        s << "            { " << p << "MeanResidual, " << p << "CenteredMeanShape, " << p << "Center, " << p << "SquaredNorm, "
+          << p << "Offsets, " << p << "AnchorIds, " << p << "NumCoords, " << p << "Forest }" << ((i + 1 < numStages) ? "," : "") << "\n";
+    }
+    s << "        };\n\n";
+    s << "    }\n\n";
+
+    // Mirrors Tracker::predict and Regressor::predict.
+    s << "    dest::core::Shape predict(const Eigen::Ref<const dest::core::Image> &img, const dest::core::ShapeTransform &shapeToImage)\n";
+    s << "    {\n";
+    s << "        dest::core::Shape estimate = Eigen::Map<const dest::core::Shape>(meanShape, 2, NumLandmarks);\n";
+    s << "        dest::core::ShapeResidual residual;\n";
+    s << "        dest::core::PixelCoordinates anchors(2, NumLandmarks);\n";
+    s << "        dest::core::PixelIntensities intensities;\n\n";
+    s << "        for (int i = 0; i < " << numStages << "; ++i) {\n";
+    s << "            const Stage &stage = stages[i];\n\n";
+    s << "            const Eigen::AffineCompact2f shapeToShape = dest::core::estimateSimilarityTransform(\n";
+    s << "                Eigen::Map<const dest::core::Shape>(stage.centeredMeanShape, 2, NumLandmarks),\n";
+    s << "                Eigen::Vector2f(stage.center[0], stage.center[1]), stage.squaredNorm, estimate);\n\n";
+    s << "            for (int k = 0; k < NumLandmarks; ++k) {\n";
+    s << "                anchors.col(k) = shapeToImage * estimate.col(k);\n";
+    s << "            }\n";
+    s << "            const Eigen::Matrix2f linear = shapeToImage.linear() * shapeToShape.linear();\n\n";
+    s << "            dest::core::readImage(img, linear,\n";
+    s << "                                  Eigen::Map<const dest::core::PixelCoordinates>(stage.offsets, 2, stage.numCoords),\n";
+    s << "                                  Eigen::Map<const Eigen::VectorXi>(stage.anchorIds, stage.numCoords),\n";
+    s << "                                  anchors, intensities);\n\n";
+    s << "            residual = Eigen::Map<const dest::core::ShapeResidual>(stage.meanResidual, 2, NumLandmarks);\n";
+    s << "            stage.forest(intensities.data(), residual.data());\n";
+    s << "            estimate += residual;\n";
+    s << "        }\n\n";
+    s << "        dest::core::Shape result(2, NumLandmarks);\n";
+    s << "        for (int k = 0; k < NumLandmarks; ++k) {\n";
+    s << "            result.col(k) = shapeToImage * estimate.col(k);\n";
+    s << "        }\n";
+    s << "        return result;\n";
+    s << "    }\n\n";
+    s << "}\n";
+
+    if (!h.good() || !s.good()) {
+        std::cerr << "Failed to write generated code." << std::endl;
+        return -1;
+    }
+
+    std::cout << "Saved generated code to " << opts.output << ".h and " << opts.output << ".cpp" << std::endl;
+
+    return 0;
+}
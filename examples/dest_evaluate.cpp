@@ -27,6 +27,9 @@ int main(int argc, char **argv)
         std::string database;
         std::string rectangles;
         int loadMaxSize;
+        int numThreads;
+        std::string evaluation;
+        dest::core::PredictOptions predict;
     } opts;
 
     try {
@@ -34,6 +37,16 @@ int main(int argc, char **argv)
         TCLAP::ValueArg<std::string> trackerArg("t", "tracker", "Trained tracker to load", true, "dest.bin", "file", cmd);
         TCLAP::ValueArg<std::string> rectanglesArg("r", "rectangles", "Initial rectangles to provide to tracker", false, "rectangles.csv", "file", cmd);
         TCLAP::ValueArg<int> maxImageSizeArg("", "load-max-size", "Maximum size of images in the database", false, 2048, "int", cmd);
+        TCLAP::ValueArg<int> numThreadsArg("", "threads", "Number of alignment threads. Zero uses all hardware threads.", false, 0, "int", cmd);
+        std::vector<std::string> evaluations;
+        evaluations.push_back("walk");
+        evaluations.push_back("bitvector");
+        evaluations.push_back("fixed");
+        TCLAP::ValuesConstraint<std::string> evaluationConstraint(evaluations);
+        TCLAP::ValueArg<std::string> evaluationArg("", "evaluation", "Tree evaluation strategy: tree walks, bitvectors or tree walks on 16 bit fixed point intensities.", false, "walk", &evaluationConstraint, cmd);
+        TCLAP::ValueArg<int> maxStagesArg("", "max-stages", "Maximum number of cascade stages to run. Zero runs all stages.", false, 0, "int", cmd);
+        TCLAP::ValueArg<int> maxTreesArg("", "max-trees", "Maximum number of trees to evaluate per cascade stage. Zero evaluates all trees.", false, 0, "int", cmd);
+        TCLAP::ValueArg<float> convergenceArg("", "convergence-threshold", "Skip remaining cascade stages once the RMS landmark update falls below this threshold in normalized shape space.", false, 0.f, "float", cmd);
         TCLAP::UnlabeledValueArg<std::string> databaseArg("database", "Path to database directory to load", true, "./db", "string", cmd);
         
 
@@ -43,14 +56,26 @@ int main(int argc, char **argv)
         opts.database = databaseArg.getValue();
         opts.tracker = trackerArg.getValue();
         opts.loadMaxSize = maxImageSizeArg.getValue();
+        opts.numThreads = numThreadsArg.getValue();
+        opts.evaluation = evaluationArg.getValue();
+        opts.predict.maxStages = maxStagesArg.getValue();
+        opts.predict.maxTreesPerStage = maxTreesArg.getValue();
+        opts.predict.convergenceThreshold = convergenceArg.getValue();
     }
     catch (TCLAP::ArgException &e) {
         std::cerr << "Error: " << e.error() << " for arg " << e.argId() << std::endl;
         return -1;
     }
     
+    dest::core::ForestEvaluation evaluation = dest::core::ForestEvaluation_TreeWalk;
+    if (opts.evaluation == "bitvector") {
+        evaluation = dest::core::ForestEvaluation_BitVector;
+    } else if (opts.evaluation == "fixed") {
+        evaluation = dest::core::ForestEvaluation_FixedPoint;
+    }
+
     dest::core::Tracker t;
-    if (!t.load(opts.tracker)) {
+    if (!t.load(opts.tracker, evaluation)) {
         std::cerr << "Failed to load tracker." << std::endl;
         return -1;
     }
@@ -90,7 +115,7 @@ int main(int argc, char **argv)
         return -1;
     }
     
-    dest::core::TestResult tr = dest::core::testTracker(td, t, ldn);
+    dest::core::TestResult tr = dest::core::testTracker(td, t, ldn, opts.numThreads, opts.predict);
 
     std::cout << std::setw(40) << std::left << "Average normalized error:" << tr.meanNormalizedDistance << std::endl;
     std::cout << std::setw(40) << std::left << "Stddev normalized error:" << tr.stddevNormalizedDistance << std::endl;
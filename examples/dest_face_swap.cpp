@@ -73,17 +73,20 @@ int main(int argc, char **argv)
     cv::cvtColor(imageRef, imageRefGray, CV_BGR2GRAY);
     dest::core::MappedImage mappedGray = dest::util::toDestHeaderOnly(imageRefGray);
     
-    std::vector<size_t> permutation;
-    std::vector<dest::core::Shape> boundaryFaces;
+    std::vector<dest::core::ShapeTransform> shapeToImage;
     for (size_t i = 0; i < faceRects.size(); ++i) {
         dest::core::Rect r;
         dest::util::toDest(faceRects[i], r);
-        dest::core::ShapeTransform shapeToImage = dest::core::estimateSimilarityTransform(dest::core::unitRectangle(), r);
-        faces.push_back(t.predict(mappedGray, shapeToImage));
-        
-        std::vector<dest::core::Shape::Index> tris = dest::util::triangulateShape(faces.back());
+        shapeToImage.push_back(dest::core::estimateSimilarityTransform(dest::core::unitRectangle(), r));
+    }
+    t.predictBatch(mappedGray, shapeToImage, faces);
+    
+    std::vector<size_t> permutation;
+    std::vector<dest::core::Shape> boundaryFaces;
+    for (size_t i = 0; i < faces.size(); ++i) {
+        std::vector<dest::core::Shape::Index> tris = dest::util::triangulateShape(faces[i]);
         dest::core::Shape boundaryFace;
-        dest::util::boundaryShapeVertices(faces.back(), tris, &boundaryFace);
+        dest::util::boundaryShapeVertices(faces[i], tris, &boundaryFace);
         boundaryFaces.push_back(boundaryFace);
         
         permutation.push_back(i);
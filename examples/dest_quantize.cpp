@@ -0,0 +1,86 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+#include <dest/dest.h>
+#include <tclap/CmdLine.h>
+#include <iostream>
+
+/**
+    Convert the leaf residuals of a trained tracker to a different storage type.
+
+    Leaf residuals dominate the size of a tracker. Storing them as 16 bit integers
+    with a scale per regressor or as half precision floats halves the file size
+    and reduces the memory touched during prediction.
+
+    Additionally leaf residuals can be compressed to coefficients of a small shape
+    basis per regressor, which reduces size and prediction time further.
+*/
+int main(int argc, char **argv)
+{
+    struct {
+        std::string tracker;
+        std::string output;
+        std::string encoding;
+        int components;
+    } opts;
+
+    try {
+        TCLAP::CmdLine cmd("Convert leaf residuals of a trained tracker.", ' ', "0.9");
+        TCLAP::ValueArg<std::string> outputArg("o", "output", "Converted tracker file", false, "dest_quantized.bin", "file", cmd);
+
+        std::vector<std::string> encodings;
+        encodings.push_back("int16");
+        encodings.push_back("float16");
+        encodings.push_back("float32");
+        TCLAP::ValuesConstraint<std::string> encodingConstraint(encodings);
+        TCLAP::ValueArg<std::string> encodingArg("e", "encoding", "Storage type of leaf residuals", false, "int16", &encodingConstraint, cmd);
+
+        TCLAP::ValueArg<int> componentsArg("c", "components", "Number of shape basis vectors to compress leaf residuals to. Zero keeps full residuals.", false, 0, "int", cmd);
+
+        TCLAP::UnlabeledValueArg<std::string> trackerArg("tracker", "Trained tracker to convert", true, "dest.bin", "file", cmd);
+
+        cmd.parse(argc, argv);
+
+        opts.tracker = trackerArg.getValue();
+        opts.output = outputArg.getValue();
+        opts.encoding = encodingArg.getValue();
+        opts.components = componentsArg.getValue();
+    }
+    catch (TCLAP::ArgException &e) {
+        std::cerr << "Error: " << e.error() << " for arg " << e.argId() << std::endl;
+        return -1;
+    }
+
+    dest::core::Tracker t;
+    if (!t.load(opts.tracker)) {
+        std::cerr << "Failed to load tracker." << std::endl;
+        return -1;
+    }
+
+    dest::core::LeafEncoding encoding = dest::core::LeafEncoding_Float32;
+    if (opts.encoding == "int16") {
+        encoding = dest::core::LeafEncoding_Int16;
+    } else if (opts.encoding == "float16") {
+        encoding = dest::core::LeafEncoding_Float16;
+    }
+
+    // Compress float leaves first, so that only the coefficients are rounded.
+    t.compressLeaves(opts.components);
+    t.setLeafEncoding(encoding);
+
+    if (!t.save(opts.output)) {
+        std::cerr << "Failed to save tracker." << std::endl;
+        return -1;
+    }
+
+    std::cout << "Saved converted tracker to " << opts.output << std::endl;
+
+    return 0;
+}
@@ -40,6 +40,7 @@ int main(int argc, char **argv)
         int detectRate;
         bool drawRect;
         float imageScale;
+        dest::core::PredictOptions predict;
     } opts;
     
     try {
@@ -51,6 +52,9 @@ int main(int argc, char **argv)
         TCLAP::UnlabeledValueArg<std::string> deviceArg("device", "Device to be opened. Either filename of video or camera device id.", true, "0", "string", cmd);
         TCLAP::SwitchArg drawRectArg("", "draw-rect", "Draw face detector rectangle", cmd, false);
         TCLAP::ValueArg<int> detectInNthFrameArg("", "detect-rate", "Use detector in every n-th frame. If false tries to mimick detector for fast tracking.", false, 5, "int", cmd);
+        TCLAP::ValueArg<int> maxStagesArg("", "max-stages", "Maximum number of cascade stages to run. Zero runs all stages.", false, 0, "int", cmd);
+        TCLAP::ValueArg<int> maxTreesArg("", "max-trees", "Maximum number of trees to evaluate per cascade stage. Zero evaluates all trees.", false, 0, "int", cmd);
+        TCLAP::ValueArg<float> convergenceArg("", "convergence-threshold", "Skip remaining cascade stages once the RMS landmark update falls below this threshold in normalized shape space.", false, 0.f, "float", cmd);
         
         cmd.parse(argc, argv);
         
@@ -60,6 +64,9 @@ int main(int argc, char **argv)
         opts.detectRate = detectInNthFrameArg.getValue();
         opts.drawRect = drawRectArg.getValue();
         opts.imageScale = imageScaleArg.getValue();
+        opts.predict.maxStages = maxStagesArg.getValue();
+        opts.predict.maxTreesPerStage = maxTreesArg.getValue();
+        opts.predict.convergenceThreshold = convergenceArg.getValue();
     }
     catch (TCLAP::ArgException &e) {
         std::cerr << "Error: " << e.error() << " for arg " << e.argId() << std::endl;
@@ -105,6 +112,7 @@ int main(int argc, char **argv)
     dest::core::Rect r;
     dest::core::Shape s;
     dest::core::ShapeTransform shapeToImage;
+    dest::core::PredictionContext ctx = t.createPredictionContext();
     bool done = false;
     bool requestDetect = false;
     bool detectSuccess = false;
@@ -127,7 +135,7 @@ int main(int argc, char **argv)
             if (fd.detectSingleFace(grayCV, cvRect)) {
                 dest::util::toDest(cvRect, r);
                 shapeToImage = dest::core::estimateSimilarityTransform(dest::core::unitRectangle(), r);
-                s = t.predict(img, shapeToImage);
+                t.predict(img, shapeToImage, opts.predict, ctx, s);
 
                 requestDetect = false;
                 detectSuccess = true;
@@ -150,7 +158,7 @@ int main(int argc, char **argv)
             r = tr * r.colwise().homogeneous();
 
             shapeToImage = dest::core::estimateSimilarityTransform(dest::core::unitRectangle(), r);
-            s = t.predict(img, shapeToImage);
+            t.predict(img, shapeToImage, opts.predict, ctx, s);
         }
 
         dest::util::drawShape(imgCVScaled, s, cv::Scalar(255, 0, 102));
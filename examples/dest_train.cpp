@@ -44,7 +44,8 @@ int main(int argc, char **argv)
         TCLAP::ValueArg<int> randomSeedArg("", "train-rnd-seed", "Seed for the random number generator", false, 10, "int", cmd);
         TCLAP::ValueArg<float> lambdaArg("", "train-lambda", "Prior that favors closer pixel coordinates.", false, 0.1f, "float", cmd);
         TCLAP::ValueArg<float> learnArg("", "train-learn", "Learning rate of each tree.", false, 0.08f, "float", cmd);
-        
+        TCLAP::ValueArg<int> numThreadsArg("", "train-threads", "Number of threads when compiled with OpenMP. Zero uses all cores.", false, 0, "int", cmd);
+
         TCLAP::ValueArg<int> numShapesPerImageArg("", "create-num-shapes", "Number of shapes per image to create.", false, 20, "int", cmd);
         
         TCLAP::SwitchArg showInitialSamplesArg("", "show-samples", "Show generated samples", cmd, false);
@@ -66,6 +67,7 @@ int main(int argc, char **argv)
         opts.trainingParams.numRandomSplitTestsPerNode = numSplitTestsArg.getValue();
         opts.trainingParams.exponentialLambda = lambdaArg.getValue();
         opts.trainingParams.learningRate = learnArg.getValue();
+        opts.trainingParams.numThreads = numThreadsArg.getValue();
         opts.randomSeed = randomSeedArg.getValue();
         
         opts.loadMaxSize = maxImageSizeArg.getValue();
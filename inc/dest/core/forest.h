@@ -0,0 +1,213 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+#ifndef DEST_FOREST_H
+#define DEST_FOREST_H
+
+#include <dest/core/image.h>
+#include <dest/core/shape.h>
+#include <dest/core/tree.h>
+#include <memory>
+#include <vector>
+
+namespace dest {
+    namespace core {
+
+        /**
+            Strategy to evaluate a forest.
+        */
+        enum ForestEvaluation {
+            /** Walk each tree from root to leaf. */
+            ForestEvaluation_TreeWalk,
+
+            /**
+                Evaluate split tests grouped by pixel pair and determine exit leaves
+                using bitvectors (QuickScorer). Avoids data dependent node loads.
+                Supported for trees of depth up to 7.
+            */
+            ForestEvaluation_BitVector,
+
+            /**
+                Walk each tree using integer split tests on fixed point intensities (see readImageFixed).
+                Approximates float evaluation, as intensities are interpolated with rounded weights.
+                Only the fixed point predict overloads may be used.
+
+                Intensities take half the memory of float intensities. Sampling and tree walks
+                use AVX2 when available and run about as fast as ForestEvaluation_TreeWalk there.
+            */
+            ForestEvaluation_FixedPoint
+        };
+
+        /** Type of fixed point intensities of multiple shapes, one column per shape. */
+        typedef Eigen::Matrix<short, Eigen::Dynamic, Eigen::Dynamic> FixedPixelIntensitiesMatrix;
+
+        /**
+            Storage type of leaf residuals.
+        */
+        enum LeafEncoding {
+            /** Single precision floats. */
+            LeafEncoding_Float32,
+
+            /** Signed 16 bit integers with a common scale per forest. */
+            LeafEncoding_Int16,
+
+            /** IEEE 754 half precision floats with a common scale per forest. */
+            LeafEncoding_Float16
+        };
+
+        /**
+            Quantize leaf values to 16 bit and replace them by their dequantized values.
+
+            All values share a common scale that maps the largest magnitude to the 16 bit range.
+            Quantizing the dequantized values again with the returned scale reproduces them exactly,
+            which allows quantized leaves to be passed around and stored as floats without further loss.
+
+            \param values Values to quantize. Unchanged for LeafEncoding_Float32.
+            \param encoding Target encoding.
+            \returns Common scale of the quantized values.
+        */
+        float quantizeLeaves(Eigen::MatrixXf &values, LeafEncoding encoding);
+
+        /** Maximum number of basis vectors compressed leaf residuals may use. */
+        const int MaxLeafComponents = 64;
+
+        /**
+            Packed ensemble of decision trees optimized for prediction.
+
+            While Tree is organized for training, Forest stores the split tests of all trees
+            of a regressor in a single contiguous array and all leaf residuals in a single
+            contiguous block. Leaf residuals are pre-multiplied by the learning rate, or the
+            learning rate is folded into the common scale of quantized leaves, so prediction
+            reduces to a tree walk followed by a streaming add per tree.
+
+            Each tree is stored as full binary tree of the forest's depth. Premature leaves
+            are completed during packing by routing all tests below them to the left and
+            replicating their residual to all leaves of the subtree. Hence every walk performs
+            exactly depth-1 tests, which allows branch free traversal that is unrolled at
+            compile time for common depths.
+
+            Trees are walked in blocks before the residuals of the reached leaves are accumulated.
+            Float leaves are accumulated by AVX2 or AVX-512 kernels when the host supports them.
+            Otherwise accumulation is specialized at compile time for common landmark counts
+            (58, 68 and 74) and falls back to dynamic sizes.
+        */
+        class Forest {
+        public:
+            Forest();
+            Forest(const Forest &other);
+            ~Forest();
+            Forest &operator=(const Forest &other);
+
+            /**
+                Build packed representation from trained trees.
+
+                \param trees Trees to pack.
+                \param learningRate Factor leaf residuals are scaled with.
+                \param evaluation Strategy used during prediction. Falls back to tree walks if
+                                  bitvector evaluation is not supported for the given trees.
+                \param encoding Storage type of leaf residuals. Quantized leaves are converted
+                                back to float while accumulating.
+                \param leafBasis If not null and not empty, leaf residuals are compressed to their
+                                 coefficients in this orthonormal basis, one column per basis vector
+                                 and at most MaxLeafComponents columns. Coefficients are summed over
+                                 all trees and expanded once per prediction. The encoding then
+                                 applies to coefficients.
+                \param leafValues If not null, used instead of the leaf residuals of the trees. One
+                                  column per leaf in the order of Tree::collectLeafMeans, trees
+                                  concatenated. Coefficients when a leaf basis is given.
+                \param leafScale If positive, leaf values are already quantized to the encoding by
+                                 quantizeLeaves with this scale and are stored without further loss.
+            */
+            void build(const std::vector<Tree> &trees, float learningRate, 
+                       ForestEvaluation evaluation = ForestEvaluation_TreeWalk, 
+                       LeafEncoding encoding = LeafEncoding_Float32,
+                       const Eigen::MatrixXf *leafBasis = 0,
+                       const Eigen::MatrixXf *leafValues = 0,
+                       float leafScale = 0.f);
+
+            /**
+                Accumulate incremental shape update from image intensities.
+
+                \param intensities Image intensities
+                \param residual Shape residual to add the contribution of all trees to.
+                \param maxTrees Evaluate only the first maxTrees trees. Zero uses all trees.
+            */
+            void predict(const PixelIntensities &intensities, ShapeResidual &residual, int maxTrees = 0) const;
+
+            /**
+                Accumulate incremental shape updates of multiple shapes.
+
+                Trees are processed in blocks of up to 256. Each block is walked for every shape
+                in turn before advancing to the next block, so that the nodes and leaves of a
+                block are reused across shapes. With compressed leaves shapes are processed one
+                after another.
+
+                \param intensities Image intensities, one column per shape.
+                \param residuals Shape residuals to add the contribution of all trees to, one column per shape.
+                \param maxTrees Evaluate only the first maxTrees trees. Zero uses all trees.
+            */
+            void predict(const Eigen::MatrixXf &intensities, Eigen::MatrixXf &residuals, int maxTrees = 0) const;
+
+            /**
+                Accumulate incremental shape update from fixed point image intensities.
+
+                Requires the forest to be built for ForestEvaluation_FixedPoint.
+
+                \param intensities Fixed point image intensities
+                \param residual Shape residual to add the contribution of all trees to.
+                \param maxTrees Evaluate only the first maxTrees trees. Zero uses all trees.
+            */
+            void predict(const FixedPixelIntensities &intensities, ShapeResidual &residual, int maxTrees = 0) const;
+
+            /**
+                Accumulate incremental shape updates of multiple shapes from fixed point image intensities.
+
+                Requires the forest to be built for ForestEvaluation_FixedPoint.
+
+                \param intensities Fixed point image intensities, one column per shape.
+                \param residuals Shape residuals to add the contribution of all trees to, one column per shape.
+                \param maxTrees Evaluate only the first maxTrees trees. Zero uses all trees.
+            */
+            void predict(const FixedPixelIntensitiesMatrix &intensities, Eigen::MatrixXf &residuals, int maxTrees = 0) const;
+
+            /**
+                Number of packed trees.
+            */
+            int numTrees() const;
+
+            /**
+                Depth of packed trees including root level.
+            */
+            int depth() const;
+
+            /**
+                Strategy used during prediction.
+            */
+            ForestEvaluation evaluation() const;
+
+            /**
+                Storage type of leaf residuals.
+            */
+            LeafEncoding leafEncoding() const;
+
+            /**
+                Number of basis vectors leaf residuals are compressed to. Zero if not compressed.
+            */
+            int numLeafComponents() const;
+
+        private:
+            struct data;
+            std::unique_ptr<data> _data;
+        };
+
+    }
+}
+
+#endif
@@ -0,0 +1,93 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+#ifndef DEST_PARALLEL_ALIGNER_H
+#define DEST_PARALLEL_ALIGNER_H
+
+#include <dest/core/image.h>
+#include <dest/core/shape.h>
+#include <dest/core/tracker.h>
+#include <memory>
+#include <vector>
+
+namespace dest {
+    namespace core {
+
+        /**
+            Alignment of all shapes in a single image.
+
+            References the image memory without copying it. The memory needs to stay
+            valid until the job has been processed.
+        */
+        struct AlignmentJob {
+            AlignmentJob(const Eigen::Ref<const Image> &img, const std::vector<ShapeTransform> &shapeToImage);
+
+            /** View on the referenced image. */
+            MappedImage image() const;
+
+            const unsigned char *pixels;
+            int rows;
+            int cols;
+            int outerStride;
+
+            /** Inverse shape normalization transform per shape to align. */
+            std::vector<ShapeTransform> shapeToImage;
+        };
+
+        /**
+            Aligns shapes of many images in parallel.
+
+            Jobs are distributed across a pool of worker threads that share a single tracker. Each
+            worker owns its PredictionContext and a queue of jobs. Workers that run out of jobs
+            steal from the queues of other workers, which balances the load when the number of
+            shapes per image varies a lot.
+
+            The tracker needs to outlive the aligner.
+        */
+        class ParallelAligner {
+        public:
+            /**
+                Start worker threads.
+
+                \param t Tracker to align with.
+                \param numThreads Number of worker threads. When zero, one thread per hardware thread is used.
+                \param opts Options controlling the cost of prediction.
+            */
+            ParallelAligner(const Tracker &t, int numThreads = 0, const PredictOptions &opts = PredictOptions());
+            ~ParallelAligner();
+
+            /**
+                Align all jobs.
+
+                Blocks until all jobs have been processed. Concurrent calls on the same aligner
+                are serialized, each waits for the batches of earlier calls to finish.
+
+                \param jobs Jobs to process.
+                \param results Receives the aligned shapes in image space, one list of shapes per job.
+            */
+            void align(const std::vector<AlignmentJob> &jobs, std::vector< std::vector<Shape> > &results);
+
+            /**
+                Number of worker threads.
+            */
+            int numThreads() const;
+
+        private:
+            ParallelAligner(const ParallelAligner &other);
+            ParallelAligner &operator=(const ParallelAligner &other);
+
+            struct data;
+            std::unique_ptr<data> _data;
+        };
+
+    }
+}
+
+#endif
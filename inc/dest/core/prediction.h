@@ -0,0 +1,113 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+#ifndef DEST_PREDICTION_H
+#define DEST_PREDICTION_H
+
+#include <dest/core/image.h>
+#include <dest/core/shape.h>
+#include <vector>
+
+namespace dest {
+    namespace core {
+
+        /**
+            Runtime options controlling the cost of shape prediction.
+
+            Allows a single trained tracker to trade accuracy for latency per request.
+        */
+        struct PredictOptions {
+            /**
+                Early exit threshold for the cascade.
+
+                Remaining cascade stages are skipped as soon as the root mean square landmark displacement
+                of a stage update falls below this threshold. Measured in normalized shape space, where the
+                normalization rectangle has unit size. When tracking in videos most frames converge within
+                a few stages. A threshold of zero always runs all stages.
+            */
+            float convergenceThreshold;
+
+            /**
+                Maximum number of cascade stages to run. Zero runs all stages.
+            */
+            int maxStages;
+
+            /**
+                Maximum number of trees to evaluate per cascade stage. Zero evaluates all trees.
+
+                Trees of a stage are fitted one after another to the remaining residual, so the
+                leading trees carry most of the update.
+            */
+            int maxTreesPerStage;
+
+            PredictOptions()
+                : convergenceThreshold(0.f), maxStages(0), maxTreesPerStage(0)
+            {}
+        };
+
+        /**
+            Reusable workspace for shape prediction.
+
+            Holds the scratch buffers that would otherwise be allocated in every call to
+            Tracker::predict. Once sized for a tracker, prediction does not allocate memory.
+
+            A context must not be shared between threads. A single const Tracker, however,
+            can be used by many threads concurrently when each thread owns its context.
+            Use Tracker::createPredictionContext to create a context sized for a tracker.
+        */
+        struct PredictionContext {
+            /** Landmarks of the current shape estimate in image space, anchoring the pixel coordinates. */
+            PixelCoordinates anchors;
+
+            /** Sampled pixel intensities. */
+            PixelIntensities intensities;
+
+            /** Sampled pixel intensities in fixed point when evaluating with ForestEvaluation_FixedPoint. */
+            FixedPixelIntensities fixedIntensities;
+
+            /** Current shape estimate in normalized shape space. */
+            Shape estimate;
+
+            /** Incremental shape update of current regressor. */
+            ShapeResidual residual;
+
+            /** Sampled pixel intensities during batch prediction, one column per shape. */
+            Eigen::MatrixXf batchIntensities;
+
+            /** Sampled fixed point pixel intensities during batch prediction, one column per shape. */
+            Eigen::Matrix<short, Eigen::Dynamic, Eigen::Dynamic> batchFixedIntensities;
+
+            /** Current shape estimates during batch prediction, one column per shape. */
+            Eigen::MatrixXf batchEstimates;
+
+            /** Incremental shape updates during batch prediction, one column per shape. */
+            Eigen::MatrixXf batchResiduals;
+
+            /** Shapes that have not converged yet during batch prediction. */
+            std::vector<int> batchActive;
+
+            /** Shape estimates of not yet converged shapes during batch prediction. */
+            Eigen::MatrixXf batchActiveEstimates;
+
+            /** Shape normalization transforms of not yet converged shapes during batch prediction. */
+            std::vector<ShapeTransform> batchActiveTransforms;
+
+            /** Number of cascade stages run by the last prediction using this context. Maximum over all shapes of a batch. */
+            int numStages;
+
+            PredictionContext()
+                : numStages(0)
+            {}
+        };
+
+    }
+}
+
+#endif
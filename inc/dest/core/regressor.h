@@ -13,9 +13,12 @@
 
 #include <dest/core/image.h>
 #include <dest/core/shape.h>
+#include <dest/core/prediction.h>
+#include <dest/core/forest.h>
 #include <dest/core/training_data.h>
 #include <dest/io/dest_io_generated.h>
 #include <memory>
+#include <vector>
 
 namespace dest {
     namespace core {
@@ -44,6 +47,40 @@ namespace dest {
             */
             ShapeResidual predict(const Eigen::Ref<const Image> &img, const Shape &shape, const ShapeTransform &shapeToImage) const;
 
+            /**
+                Predict incremental shape from current shape estimate using a reusable workspace.
+
+                Does not allocate memory when context buffers are already sized appropriately.
+
+                \param img Image to sample from
+                \param shape Current shape estimate
+                \param shapeToImage Global similarity transform from normalized shape space to image.
+                \param ctx Workspace providing scratch buffers.
+                \param residual Receives the incremental shape update.
+                \param opts Options controlling the cost of prediction. Only maxTreesPerStage applies.
+            */
+            void predict(const Eigen::Ref<const Image> &img, const Shape &shape, const ShapeTransform &shapeToImage, PredictionContext &ctx, ShapeResidual &residual, const PredictOptions &opts = PredictOptions()) const;
+
+            /**
+                Predict incremental shapes of multiple shape estimates in the same image.
+
+                Samples intensities for all shapes first and then walks blocks of trees for all
+                shapes (see Forest::predict).
+
+                \param img Image to sample from
+                \param shapes Current shape estimates, one column of 2 x numLandmarks values per shape.
+                \param shapeToImage Global similarity transform from normalized shape space to image per shape.
+                \param ctx Workspace providing scratch buffers.
+                \param residuals Receives the incremental shape updates, one column per shape.
+                \param opts Options controlling the cost of prediction. Only maxTreesPerStage applies.
+            */
+            void predictBatch(const Eigen::Ref<const Image> &img, const Eigen::MatrixXf &shapes, const std::vector<ShapeTransform> &shapeToImage, PredictionContext &ctx, Eigen::MatrixXf &residuals, const PredictOptions &opts = PredictOptions()) const;
+
+            /**
+                Number of pixel coordinates sampled per prediction.
+            */
+            int numPixelCoordinates() const;
+
             /**
                 Save trained regressor to flatbuffers.
             */
@@ -51,13 +88,62 @@ namespace dest {
 
             /**
                 Load trained regressor from flatbuffers.
+
+                \param fbs Serialized regressor.
+                \param evaluation Strategy to evaluate the regressor's trees during prediction.
             */
-            void load(const io::Regressor &fbs);
-            
+            void load(const io::Regressor &fbs, ForestEvaluation evaluation = ForestEvaluation_TreeWalk);
+
+            /**
+                Change storage type of leaf residuals.
+
+                Quantized leaves reduce the memory footprint of prediction and the size of saved
+                regressors. Leaf residuals are dequantized while accumulating. Quantization replaces
+                the leaf residuals of the trees by their quantized values, so predictions do not
+                change when the regressor is saved and reloaded. Converting back to
+                LeafEncoding_Float32 does not recover the precision lost.
+            */
+            void setLeafEncoding(LeafEncoding encoding);
+
+            /**
+                Storage type of leaf residuals.
+            */
+            LeafEncoding leafEncoding() const;
+
+            /**
+                Compress leaf residuals to coefficients of a small shape basis.
+
+                Leaf residuals of a regressor are highly correlated shape deformations. This projects
+                all leaf residuals onto their leading principal directions and stores only the
+                coefficients per leaf. Prediction sums coefficients across all trees and expands
+                them to a shape residual once. Reduces model size and accumulation cost roughly by
+                the ratio of residual size to number of components. The leaf encoding applies to
+                the coefficients.
+
+                Like quantization, compression replaces the leaf residuals of the trees by their
+                compressed values, so predictions do not change when the regressor is saved and
+                reloaded.
+
+                To quantize compressed leaves, compress float leaves first and change the encoding
+                afterwards. Compressing already quantized leaves fits the basis to rounded residuals
+                and rounds the coefficients a second time.
+
+                \param numComponents Number of basis vectors, at most MaxLeafComponents. Zero
+                                     disables compression.
+            */
+            void compressLeaves(int numComponents);
+
+            /**
+                Number of basis vectors leaf residuals are compressed to. Zero if not compressed.
+            */
+            int numLeafComponents() const;
+
         private:
             
             PixelCoordinates sampleCoordinates(RegressorTraining &t) const;
-            void readPixelIntensities(const Eigen::AffineCompact2f &shapeToShape, const Eigen::AffineCompact2f &shapeToImage, const Shape &s, const Image &i, PixelIntensities &intensities) const;
+            Eigen::Matrix2f transformAnchors(const Eigen::AffineCompact2f &shapeToShape, const Eigen::AffineCompact2f &shapeToImage, const Eigen::Ref<const Shape> &s, PixelCoordinates &anchors) const;
+            void readPixelIntensities(const Eigen::AffineCompact2f &shapeToShape, const Eigen::AffineCompact2f &shapeToImage, const Eigen::Ref<const Shape> &s, const Eigen::Ref<const Image> &img, PixelCoordinates &anchors, PixelIntensities &intensities) const;
+            void readPixelIntensities(const Eigen::AffineCompact2f &shapeToShape, const Eigen::AffineCompact2f &shapeToImage, const Eigen::Ref<const Shape> &s, const Eigen::Ref<const Image> &img, PixelCoordinates &anchors, FixedPixelIntensities &intensities) const;
             
             struct data;
             std::unique_ptr<data> _data;
@@ -41,6 +41,25 @@ namespace dest {
         */
         Eigen::AffineCompact2f estimateSimilarityTransform(const Eigen::Ref<const Shape> &from, const Eigen::Ref<const Shape> &to);
 
+        /**
+            Estimate a best-fit similarity transform from a pre-centered source shape.
+
+            Same as estimateSimilarityTransform(from, to) but skips centering the source shape. Use
+            this when the source is fixed and the transform is estimated repeatedly, such as the mean
+            shape of a regressor.
+
+            \param centeredFrom Source shape with its mean subtracted.
+            \param meanFrom Mean of the source shape.
+            \param squaredNormFrom Sum of squared norms of centeredFrom columns.
+            \param to Target shape.
+            \returns Estimated transform.
+        */
+        Eigen::AffineCompact2f estimateSimilarityTransform(
+            const Eigen::Ref<const Shape> &centeredFrom,
+            const Eigen::Vector2f &meanFrom,
+            float squaredNormFrom,
+            const Eigen::Ref<const Shape> &to);
+
         /**
             Encode pixel coordinates relative to shape.
 
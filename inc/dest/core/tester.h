@@ -70,8 +70,10 @@ namespace dest {
             \param td SampleData to run tests on. Fills sample estimate with normalized tracker prediction.
             \param t Tracker to evaluate
             \param norm Functor providing a distance normalization factor per sample.
+            \param numThreads Number of threads to align samples with. When zero, one thread per hardware thread is used.
+            \param opts Options controlling the cost of prediction.
         */ 
-        TestResult testTracker(SampleData &td, const Tracker &t, const DistanceNormalizer &norm);
+        TestResult testTracker(SampleData &td, const Tracker &t, const DistanceNormalizer &norm, int numThreads = 0, const PredictOptions &opts = PredictOptions());
         
     }
 }
@@ -13,10 +13,13 @@
 
 #include <dest/core/image.h>
 #include <dest/core/shape.h>
+#include <dest/core/prediction.h>
+#include <dest/core/forest.h>
 #include <dest/core/training_data.h>
 #include <dest/io/dest_io_generated.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace dest {
     namespace core {
@@ -66,6 +69,79 @@ namespace dest {
             */
             Shape predict(const Eigen::Ref<const Image> &img, const ShapeTransform &shapeToImage, std::vector<Shape> *stepResults = 0) const;
 
+            /**
+                Predict shape landmarks from image and a global transform using a reusable workspace.
+
+                Does not allocate memory once the context is sized for this tracker (see createPredictionContext).
+                As prediction does not modify the tracker, multiple threads may predict concurrently
+                using the same tracker as long as each thread uses its own context.
+
+                \param img Single channel intensity input image.
+                \param shapeToImage Inverse of shape normalization transform.
+                \param ctx Workspace providing scratch buffers.
+                \param result Receives the computed landmark positions in image space.
+                \param stepResults If not null, contains the results from each regression cascade.
+            */
+            void predict(const Eigen::Ref<const Image> &img, const ShapeTransform &shapeToImage, PredictionContext &ctx, Shape &result, std::vector<Shape> *stepResults = 0) const;
+
+            /**
+                Predict shape landmarks from image and a global transform using runtime options.
+
+                The number of cascade stages actually run is available in PredictionContext::numStages
+                afterwards.
+
+                \param img Single channel intensity input image.
+                \param shapeToImage Inverse of shape normalization transform.
+                \param opts Options controlling the cost of prediction.
+                \param ctx Workspace providing scratch buffers.
+                \param result Receives the computed landmark positions in image space.
+                \param stepResults If not null, contains the results from each regression cascade run.
+            */
+            void predict(const Eigen::Ref<const Image> &img, const ShapeTransform &shapeToImage, const PredictOptions &opts, PredictionContext &ctx, Shape &result, std::vector<Shape> *stepResults = 0) const;
+
+            /**
+                Predict shape landmarks of multiple shapes in the same image.
+
+                Equivalent to calling predict for each transform, but runs each cascade for all shapes
+                together. Within a stage, blocks of trees are walked for all shapes before advancing
+                to the next block (see Forest::predict), which increases throughput when many shapes
+                (e.g. faces) are found in a single image.
+
+                \param img Single channel intensity input image.
+                \param shapeToImage Inverse of shape normalization transform per shape.
+                \param results Receives the computed landmark positions in image space per shape.
+            */
+            void predictBatch(const Eigen::Ref<const Image> &img, const std::vector<ShapeTransform> &shapeToImage, std::vector<Shape> &results) const;
+
+            /**
+                Predict shape landmarks of multiple shapes in the same image using a reusable workspace.
+
+                \param img Single channel intensity input image.
+                \param shapeToImage Inverse of shape normalization transform per shape.
+                \param ctx Workspace providing scratch buffers.
+                \param results Receives the computed landmark positions in image space per shape.
+            */
+            void predictBatch(const Eigen::Ref<const Image> &img, const std::vector<ShapeTransform> &shapeToImage, PredictionContext &ctx, std::vector<Shape> &results) const;
+
+            /**
+                Predict shape landmarks of multiple shapes in the same image using runtime options.
+
+                When early exit is enabled, converged shapes skip the remaining stages while the others
+                continue, so each result equals that of predict with the same options.
+
+                \param img Single channel intensity input image.
+                \param shapeToImage Inverse of shape normalization transform per shape.
+                \param opts Options controlling the cost of prediction.
+                \param ctx Workspace providing scratch buffers.
+                \param results Receives the computed landmark positions in image space per shape.
+            */
+            void predictBatch(const Eigen::Ref<const Image> &img, const std::vector<ShapeTransform> &shapeToImage, const PredictOptions &opts, PredictionContext &ctx, std::vector<Shape> &results) const;
+
+            /**
+                Create a prediction workspace sized for this tracker.
+            */
+            PredictionContext createPredictionContext() const;
+
             /**
                 Save trained tracker to flatbuffers.
             */
@@ -73,8 +149,11 @@ namespace dest {
 
             /**
                 Load trained regressor from flatbuffers.
+
+                \param fbs Serialized tracker.
+                \param evaluation Strategy to evaluate the trees of all cascades during prediction.
             */
-            void load(const io::Tracker &fbs);
+            void load(const io::Tracker &fbs, ForestEvaluation evaluation = ForestEvaluation_TreeWalk);
 
             /**
                 Save trained tracker to file.
@@ -83,8 +162,25 @@ namespace dest {
 
             /**
                 Load trained tracker from file.
+
+                \param path Path to tracker file.
+                \param evaluation Strategy to evaluate the trees of all cascades during prediction.
+            */
+            bool load(const std::string &path, ForestEvaluation evaluation = ForestEvaluation_TreeWalk);
+
+            /**
+                Change storage type of leaf residuals of all cascades.
+
+                See Regressor::setLeafEncoding.
+            */
+            void setLeafEncoding(LeafEncoding encoding);
+
+            /**
+                Compress leaf residuals of all cascades to a small shape basis per cascade.
+
+                See Regressor::compressLeaves.
             */
-            bool load(const std::string &path);
+            void compressLeaves(int numComponents);
 
         private:
 
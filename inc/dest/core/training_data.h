@@ -68,6 +68,13 @@ namespace dest {
             */
             float expansionRandomPixelCoordinates;
 
+            /**
+                Number of threads used by parallel training loops when compiled with OpenMP.
+                Zero uses the OpenMP default. Results do not depend on the number of threads.
+                Defaults to 0.
+            */
+            int numThreads;
+
             TrainingParameters();
         };
 
@@ -76,6 +83,11 @@ namespace dest {
         */
         std::ostream& operator<<(std::ostream &stream, const TrainingParameters &obj);
 
+        /**
+            Number of threads parallel training loops run on. Always 1 when compiled without OpenMP.
+        */
+        int numTrainingThreads(const TrainingParameters &params);
+
         /**
             Necessary input data derive generate training samples from.
 
@@ -213,24 +225,28 @@ namespace dest {
 
         /**
             Input data for tree training.
+
+            Sample data is stored in contiguous blocks with one column per sample. Trees
+            partition sample indices instead of moving sample data.
         */
         struct TreeTraining {
-            struct Sample {
-                ShapeResidual residual;
-                PixelIntensities intensities;
-
-                friend inline void swap(Sample& a, Sample& b)
-                {
-                    using std::swap;
-                    swap(a.residual, b.residual);
-                    swap(a.intensities, b.intensities);
-                }
-            };
-            typedef std::vector<Sample> SampleVector;
+            typedef std::vector<int> SampleIdVector;
 
             InputData *input;
             SampleData *training;
-            SampleVector samples;
+
+            /** Shape residuals of all samples, 2 * numLandmarks rows and one column per sample. */
+            Eigen::MatrixXf residuals;
+
+            /** Pixel intensities of all samples, one row per pixel coordinate and one column per sample. */
+            Eigen::MatrixXf intensities;
+
+            /**
+                Sample indices in the order of the most recent partitioning.
+                Initialized by Tree::fit when its size does not match the number of samples.
+            */
+            SampleIdVector sampleIds;
+
             PixelCoordinates pixelCoordinates;
             int numLandmarks;
         };
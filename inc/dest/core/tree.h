@@ -62,15 +62,90 @@ namespace dest {
             */
             ShapeResidual predict(const PixelIntensities &intensities) const;
 
+            /**
+                Accumulate incremental shape update from image intensities.
+
+                Does not allocate memory.
+
+                \param intensities Image intensities
+                \param residual Shape residual to add the scaled leaf residual to.
+                \param scale Factor to scale leaf residual with.
+            */
+            void predict(const PixelIntensities &intensities, ShapeResidual &residual, float scale) const;
+
+            /**
+                Find leaf node reached by image intensities.
+
+                \param intensities Image intensities
+                \return Index of leaf node. Use nodeMean to access its residual.
+            */
+            int predictLeaf(const Eigen::Ref<const PixelIntensities> &intensities) const;
+
+            /**
+                Depth of tree including root level.
+            */
+            int depth() const;
+
+            /**
+                Access split test of a node.
+
+                Nodes are stored as implicit binary tree, the children of node n are found
+                at 2n+1 (left) and 2n+2 (right).
+
+                \param node Node index
+                \param idx1 First pixel index of split test.
+                \param idx2 Second pixel index of split test.
+                \param threshold Threshold of split test.
+                \returns false if node is a leaf node.
+            */
+            bool nodeSplit(int node, int &idx1, int &idx2, float &threshold) const;
+
+            /**
+                Access mean residual of a leaf node.
+            */
+            const ShapeResidual &nodeMean(int node) const;
+
+            /**
+                Append mean residuals of all leaves.
+
+                Leaves are visited depth first from left to right.
+            */
+            void collectLeafMeans(std::vector<ShapeResidual> &leaves) const;
+
+            /**
+                Replace mean residuals of all leaves.
+
+                \param leaves Leaf residuals, one column per leaf in the order of collectLeafMeans.
+                \param first Column of the first leaf.
+                \returns Column following the last leaf.
+            */
+            int setLeafMeans(const Eigen::MatrixXf &leaves, int first);
+
+            /**
+                Replace pixel indices of all split tests.
+
+                \param newIndex New pixel index for each current pixel index.
+            */
+            void remapPixelIndices(const Eigen::VectorXi &newIndex);
+
             /**
                 Save tree to flatbuffers.
+
+                \param fbb Builder
+                \param leaves If not null, leaf residuals are appended to this list in the order of
+                              collectLeafMeans instead of being stored in the tree. Leaf nodes then
+                              reference their residual by index.
             */
-            flatbuffers::Offset<io::Tree> save(flatbuffers::FlatBufferBuilder &fbb) const;
+            flatbuffers::Offset<io::Tree> save(flatbuffers::FlatBufferBuilder &fbb, std::vector<ShapeResidual> *leaves = 0) const;
 
             /**
                 Load tree from flatbuffers.
+
+                \param fbs Serialized tree
+                \param leaves Leaf residuals, one column per leaf. Required when leaf nodes
+                              reference their residual by index.
             */
-            void load(const io::Tree &fbs);
+            void load(const io::Tree &fbs, const Eigen::MatrixXf *leaves = 0);
 
         private:
 
@@ -80,9 +155,14 @@ namespace dest {
             struct SplitInfo;
 
             /**
-                Split the given node if applicable.
+                Split all nodes of a single tree level concurrently and collect their children.
+            */
+            void splitLevel(TreeTraining &t, const std::vector<NodeInfo> &level, std::vector<NodeInfo> &children);
+
+            /**
+                Split the given node along the candidate of best energy if applicable.
             */
-            bool splitNode(TreeTraining &t, const NodeInfo &parent, NodeInfo &left, NodeInfo &right);
+            bool splitNode(TreeTraining &t, const NodeInfo &parent, const std::vector<SplitInfo> &splits, const std::vector<float> &energies, NodeInfo &left, NodeInfo &right);
 
             /**
                 Convert node into leaf.
@@ -95,9 +175,9 @@ namespace dest {
             void sampleSplitPositions(TreeTraining &t, std::vector<SplitInfo> &splits) const;
 
             /**
-                Compute the split energy for a single candidate.
+                Compute the split energies of a block of candidates in a single pass over the node's samples.
             */
-            float splitEnergy(TreeTraining &t, const NodeInfo &parent, const ShapeResidual &parentMeanResidual, const SplitInfo &split) const;
+            void splitEnergies(const TreeTraining &t, const NodeInfo &parent, const ShapeResidual &parentMeanResidual, const SplitInfo *splits, int numSplits, float *energies) const;
 
             struct data;
             std::unique_ptr<data> _data;
@@ -14,7 +14,9 @@
 #include <dest/core/config.h>
 #include <dest/core/shape.h>
 #include <dest/core/image.h>
+#include <dest/core/prediction.h>
 #include <dest/core/tracker.h>
+#include <dest/core/parallel_aligner.h>
 #include <dest/core/training_data.h>
 #include <dest/core/tester.h>
 #include <dest/io/rect_io.h>
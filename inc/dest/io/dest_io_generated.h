@@ -11,11 +11,24 @@ namespace io {
 
 struct MatrixF;
 struct MatrixI;
+struct QuantizedMatrix;
 struct TreeNode;
 struct Tree;
 struct Regressor;
 struct Tracker;
 
+enum QuantizationType {
+  Int16 = 0,
+  Float16 = 1
+};
+
+inline const char **EnumNamesQuantizationType() {
+  static const char *names[] = { "Int16", "Float16", nullptr };
+  return names;
+}
+
+inline const char *EnumNameQuantizationType(QuantizationType e) { return EnumNamesQuantizationType()[e]; }
+
 struct MatrixF FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   int32_t rows() const { return GetField<int32_t>(4, 0); }
   int32_t cols() const { return GetField<int32_t>(6, 0); }
@@ -94,11 +107,61 @@ inline flatbuffers::Offset<MatrixI> CreateMatrixI(flatbuffers::FlatBufferBuilder
   return builder_.Finish();
 }
 
+struct QuantizedMatrix FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  int32_t rows() const { return GetField<int32_t>(4, 0); }
+  int32_t cols() const { return GetField<int32_t>(6, 0); }
+  QuantizationType type() const { return static_cast<QuantizationType>(GetField<int8_t>(8, 0)); }
+  float scale() const { return GetField<float>(10, 0); }
+  const flatbuffers::Vector<uint16_t> *data() const { return GetPointer<const flatbuffers::Vector<uint16_t> *>(12); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int32_t>(verifier, 4 /* rows */) &&
+           VerifyField<int32_t>(verifier, 6 /* cols */) &&
+           VerifyField<int8_t>(verifier, 8 /* type */) &&
+           VerifyField<float>(verifier, 10 /* scale */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 12 /* data */) &&
+           verifier.Verify(data()) &&
+           verifier.EndTable();
+  }
+};
+
+struct QuantizedMatrixBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_rows(int32_t rows) { fbb_.AddElement<int32_t>(4, rows, 0); }
+  void add_cols(int32_t cols) { fbb_.AddElement<int32_t>(6, cols, 0); }
+  void add_type(QuantizationType type) { fbb_.AddElement<int8_t>(8, static_cast<int8_t>(type), 0); }
+  void add_scale(float scale) { fbb_.AddElement<float>(10, scale, 0); }
+  void add_data(flatbuffers::Offset<flatbuffers::Vector<uint16_t>> data) { fbb_.AddOffset(12, data); }
+  QuantizedMatrixBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  QuantizedMatrixBuilder &operator=(const QuantizedMatrixBuilder &);
+  flatbuffers::Offset<QuantizedMatrix> Finish() {
+    auto o = flatbuffers::Offset<QuantizedMatrix>(fbb_.EndTable(start_, 5));
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<QuantizedMatrix> CreateQuantizedMatrix(flatbuffers::FlatBufferBuilder &_fbb,
+   int32_t rows = 0,
+   int32_t cols = 0,
+   QuantizationType type = Int16,
+   float scale = 0,
+   flatbuffers::Offset<flatbuffers::Vector<uint16_t>> data = 0) {
+  QuantizedMatrixBuilder builder_(_fbb);
+  builder_.add_data(data);
+  builder_.add_scale(scale);
+  builder_.add_cols(cols);
+  builder_.add_rows(rows);
+  builder_.add_type(type);
+  return builder_.Finish();
+}
+
 struct TreeNode FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   int32_t idx1() const { return GetField<int32_t>(4, 0); }
   int32_t idx2() const { return GetField<int32_t>(6, 0); }
   float threshold() const { return GetField<float>(8, 0); }
   const MatrixF *mean() const { return GetPointer<const MatrixF *>(10); }
+  int32_t leaf() const { return GetField<int32_t>(12, -1); }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<int32_t>(verifier, 4 /* idx1 */) &&
@@ -106,6 +169,7 @@ struct TreeNode FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            VerifyField<float>(verifier, 8 /* threshold */) &&
            VerifyField<flatbuffers::uoffset_t>(verifier, 10 /* mean */) &&
            verifier.VerifyTable(mean()) &&
+           VerifyField<int32_t>(verifier, 12 /* leaf */) &&
            verifier.EndTable();
   }
 };
@@ -117,10 +181,11 @@ struct TreeNodeBuilder {
   void add_idx2(int32_t idx2) { fbb_.AddElement<int32_t>(6, idx2, 0); }
   void add_threshold(float threshold) { fbb_.AddElement<float>(8, threshold, 0); }
   void add_mean(flatbuffers::Offset<MatrixF> mean) { fbb_.AddOffset(10, mean); }
+  void add_leaf(int32_t leaf) { fbb_.AddElement<int32_t>(12, leaf, -1); }
   TreeNodeBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
   TreeNodeBuilder &operator=(const TreeNodeBuilder &);
   flatbuffers::Offset<TreeNode> Finish() {
-    auto o = flatbuffers::Offset<TreeNode>(fbb_.EndTable(start_, 4));
+    auto o = flatbuffers::Offset<TreeNode>(fbb_.EndTable(start_, 5));
     return o;
   }
 };
@@ -129,8 +194,10 @@ inline flatbuffers::Offset<TreeNode> CreateTreeNode(flatbuffers::FlatBufferBuild
    int32_t idx1 = 0,
    int32_t idx2 = 0,
    float threshold = 0,
-   flatbuffers::Offset<MatrixF> mean = 0) {
+   flatbuffers::Offset<MatrixF> mean = 0,
+   int32_t leaf = -1) {
   TreeNodeBuilder builder_(_fbb);
+  builder_.add_leaf(leaf);
   builder_.add_mean(mean);
   builder_.add_threshold(threshold);
   builder_.add_idx2(idx2);
@@ -180,6 +247,9 @@ struct Regressor FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   const MatrixF *meanShape() const { return GetPointer<const MatrixF *>(10); }
   const flatbuffers::Vector<flatbuffers::Offset<Tree>> *forest() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Tree>> *>(12); }
   float learningRate() const { return GetField<float>(14, 0); }
+  const QuantizedMatrix *quantizedLeaves() const { return GetPointer<const QuantizedMatrix *>(16); }
+  const MatrixF *leafBasis() const { return GetPointer<const MatrixF *>(18); }
+  const MatrixF *leafCoefficients() const { return GetPointer<const MatrixF *>(20); }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<flatbuffers::uoffset_t>(verifier, 4 /* pixelCoordinates */) &&
@@ -194,6 +264,12 @@ struct Regressor FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            verifier.Verify(forest()) &&
            verifier.VerifyVectorOfTables(forest()) &&
            VerifyField<float>(verifier, 14 /* learningRate */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 16 /* quantizedLeaves */) &&
+           verifier.VerifyTable(quantizedLeaves()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 18 /* leafBasis */) &&
+           verifier.VerifyTable(leafBasis()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 20 /* leafCoefficients */) &&
+           verifier.VerifyTable(leafCoefficients()) &&
            verifier.EndTable();
   }
 };
@@ -207,10 +283,13 @@ struct RegressorBuilder {
   void add_meanShape(flatbuffers::Offset<MatrixF> meanShape) { fbb_.AddOffset(10, meanShape); }
   void add_forest(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tree>>> forest) { fbb_.AddOffset(12, forest); }
   void add_learningRate(float learningRate) { fbb_.AddElement<float>(14, learningRate, 0); }
+  void add_quantizedLeaves(flatbuffers::Offset<QuantizedMatrix> quantizedLeaves) { fbb_.AddOffset(16, quantizedLeaves); }
+  void add_leafBasis(flatbuffers::Offset<MatrixF> leafBasis) { fbb_.AddOffset(18, leafBasis); }
+  void add_leafCoefficients(flatbuffers::Offset<MatrixF> leafCoefficients) { fbb_.AddOffset(20, leafCoefficients); }
   RegressorBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
   RegressorBuilder &operator=(const RegressorBuilder &);
   flatbuffers::Offset<Regressor> Finish() {
-    auto o = flatbuffers::Offset<Regressor>(fbb_.EndTable(start_, 6));
+    auto o = flatbuffers::Offset<Regressor>(fbb_.EndTable(start_, 9));
     return o;
   }
 };
@@ -221,8 +300,14 @@ inline flatbuffers::Offset<Regressor> CreateRegressor(flatbuffers::FlatBufferBui
    flatbuffers::Offset<MatrixF> meanShapeResidual = 0,
    flatbuffers::Offset<MatrixF> meanShape = 0,
    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Tree>>> forest = 0,
-   float learningRate = 0) {
+   float learningRate = 0,
+   flatbuffers::Offset<QuantizedMatrix> quantizedLeaves = 0,
+   flatbuffers::Offset<MatrixF> leafBasis = 0,
+   flatbuffers::Offset<MatrixF> leafCoefficients = 0) {
   RegressorBuilder builder_(_fbb);
+  builder_.add_leafCoefficients(leafCoefficients);
+  builder_.add_leafBasis(leafBasis);
+  builder_.add_quantizedLeaves(quantizedLeaves);
   builder_.add_learningRate(learningRate);
   builder_.add_forest(forest);
   builder_.add_meanShape(meanShape);
@@ -12,6 +12,9 @@
 #define DEST_MATRIX_IO_H
 
 #include <Eigen/Core>
+#include <vector>
+#include <cmath>
+#include <dest/util/float16.h>
 #include "dest_io_generated.h"
 
 namespace dest {
@@ -73,8 +76,58 @@ namespace dest {
             m = map;
         }
 
+        /**
+            Convert real valued matrix to quantized flatbuffers using the given scale for all elements.
+
+            Values already quantized with this scale are stored without loss.
+        */
+        inline flatbuffers::Offset<QuantizedMatrix> toFbs(flatbuffers::FlatBufferBuilder &fbb, const Eigen::MatrixXf &m, QuantizationType type, float scale)
+        {
+            std::vector<uint16_t> q(static_cast<size_t>(m.size()));
+
+            if (type == Int16) {
+                for (Eigen::DenseIndex i = 0; i < m.size(); ++i) {
+                    q[i] = static_cast<uint16_t>(static_cast<int16_t>(std::floor(m.data()[i] / scale + 0.5f)));
+                }
+            } else {
+                for (Eigen::DenseIndex i = 0; i < m.size(); ++i) {
+                    q[i] = util::toFloat16(m.data()[i] / scale);
+                }
+            }
+
+            flatbuffers::Offset< flatbuffers::Vector<uint16_t> > od = fbb.CreateVector(q);
+
+            QuantizedMatrixBuilder mb(fbb);
+            mb.add_rows(static_cast<int>(m.rows()));
+            mb.add_cols(static_cast<int>(m.cols()));
+            mb.add_type(type);
+            mb.add_scale(scale);
+            mb.add_data(od);
+
+            return mb.Finish();
+        }
+
+        /**
+            Convert quantized flatbuffers to real valued matrix.
+        */
+        inline void fromFbs(const QuantizedMatrix &fbsValue, Eigen::MatrixXf &m)
+        {
+            m.resize(fbsValue.rows(), fbsValue.cols());
+
+            const uint16_t *q = fbsValue.data()->data();
+            const float scale = fbsValue.scale();
+            if (fbsValue.type() == Int16) {
+                for (Eigen::DenseIndex i = 0; i < m.size(); ++i) {
+                    m.data()[i] = static_cast<float>(static_cast<int16_t>(q[i])) * scale;
+                }
+            } else {
+                for (Eigen::DenseIndex i = 0; i < m.size(); ++i) {
+                    m.data()[i] = util::fromFloat16(q[i]) * scale;
+                }
+            }
+        }
+
 
-        
     }
 }
 
@@ -0,0 +1,57 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+#ifndef DEST_CPU_H
+#define DEST_CPU_H
+
+namespace dest {
+    namespace util {
+        
+        /**
+            Instruction set extensions SIMD kernels are compiled for, ordered by width.
+        */
+        enum SimdLevel {
+            /** Portable code only. */
+            SimdLevel_None,
+            /** SSE2, the baseline of x86-64. Used by Eigen's own vectorization. */
+            SimdLevel_SSE2,
+            /** AVX2 including gathers. */
+            SimdLevel_AVX2,
+            /** AVX-512 foundation instructions. */
+            SimdLevel_AVX512
+        };
+        
+        /**
+            Widest instruction set extension supported by the executing CPU and operating system.
+
+            Detected once on first call. Always SimdLevel_None on non x86 platforms.
+        */
+        SimdLevel cpuSimdLevel();
+        
+        /**
+            Instruction set extension SIMD kernels are selected for at runtime.
+
+            Corresponds to cpuSimdLevel() unless restricted by setMaxSimdLevel. Kernels not
+            compiled into the library (see DEST_WITH_AVX2 and DEST_WITH_AVX512) fall back to
+            the next narrower level.
+        */
+        SimdLevel simdLevel();
+        
+        /**
+            Restrict the instruction set extension SIMD kernels are selected for.
+
+            Mainly useful to compare kernels. Must not be called while predictions are running.
+        */
+        void setMaxSimdLevel(SimdLevel level);
+        
+    }
+}
+
+#endif
@@ -0,0 +1,106 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+#ifndef DEST_FLOAT16_H
+#define DEST_FLOAT16_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace dest {
+    namespace util {
+
+        /**
+            Convert single precision float to IEEE 754 half precision bit pattern.
+
+            Rounds to nearest even. Values exceeding the half precision range become infinity.
+        */
+        inline uint16_t toFloat16(float value) {
+            const uint32_t f32Infinity = 255u << 23;
+            const uint32_t f16Max = (127u + 16u) << 23;
+            const uint32_t denormMagicBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+            uint32_t f;
+            std::memcpy(&f, &value, sizeof(f));
+
+            const uint32_t sign = f & 0x80000000u;
+            f ^= sign;
+
+            uint32_t o;
+            if (f >= f16Max) {
+                // Infinity or NaN
+                o = (f > f32Infinity) ? 0x7E00u : 0x7C00u;
+            } else if (f < (113u << 23)) {
+                // Denormal or zero, let the FPU round the mantissa.
+                float denormMagic, v;
+                std::memcpy(&denormMagic, &denormMagicBits, sizeof(float));
+                std::memcpy(&v, &f, sizeof(float));
+                v += denormMagic;
+                std::memcpy(&o, &v, sizeof(float));
+                o -= denormMagicBits;
+            } else {
+                const uint32_t mantissaOdd = (f >> 13) & 1u;
+                f += (uint32_t(15 - 127) << 23) + 0xFFFu;
+                f += mantissaOdd;
+                o = f >> 13;
+            }
+
+            return static_cast<uint16_t>(o | (sign >> 16));
+        }
+
+        /**
+            Convert IEEE 754 half precision bit pattern to single precision float.
+        */
+        inline float fromFloat16(uint16_t value) {
+            const uint32_t shiftedExponent = 0x7C00u << 13;
+            const uint32_t magicBits = 113u << 23;
+
+            uint32_t o = (value & 0x7FFFu) << 13;
+            const uint32_t exponent = shiftedExponent & o;
+            o += (127u - 15u) << 23;
+
+            if (exponent == shiftedExponent) {
+                // Infinity or NaN
+                o += (128u - 16u) << 23;
+            } else if (exponent == 0) {
+                // Denormal or zero, renormalize.
+                float magic, v;
+                std::memcpy(&magic, &magicBits, sizeof(float));
+                o += 1u << 23;
+                std::memcpy(&v, &o, sizeof(float));
+                v -= magic;
+                std::memcpy(&o, &v, sizeof(float));
+            }
+
+            o |= uint32_t(value & 0x8000u) << 16;
+
+            float result;
+            std::memcpy(&result, &o, sizeof(float));
+            return result;
+        }
+
+        /**
+            Convert finite IEEE 754 half precision bit pattern to single precision float.
+
+            Branch free variant of fromFloat16 that vectorizes well. Moves exponent and mantissa
+            into place and rebiases the exponent by a multiplication, which also handles denormals.
+            Infinity and NaN are not supported.
+        */
+        inline float fromFloat16Finite(uint16_t value) {
+            const uint32_t o = (uint32_t(value & 0x7FFFu) << 13) | (uint32_t(value & 0x8000u) << 16);
+            float result;
+            std::memcpy(&result, &o, sizeof(float));
+            return result * 5.192296858534828e+33f; // 2^(127-15)
+        }
+
+    }
+}
+
+#endif
@@ -0,0 +1,793 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+#include <dest/core/forest.h>
+#include <dest/core/config.h>
+#include <dest/util/cpu.h>
+#include <dest/util/float16.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace dest {
+    namespace core {
+
+#ifdef DEST_WITH_AVX2
+        /**
+            Walk blocks of eight trees using AVX2, see forest_avx2.cpp.
+            \returns the number of trees walked.
+        */
+        int walkTreesAVX2(const int *splits, int numSplitsPerTree, int numTests, int firstTree, int count, const float *pixels, int numLeavesPerTree, int *leafIds);
+
+        /**
+            Walk blocks of eight trees on fixed point intensities using AVX2, see forest_avx2.cpp.
+            \returns the number of trees walked.
+        */
+        int walkTreesFixedAVX2(const int *splits, int numSplitsPerTree, int numTests, int firstTree, int count, const short *pixels, int maxPixelIndex, int numLeavesPerTree, int *leafIds);
+
+        /**
+            Add float residuals of leaves to destination in order using AVX2, see forest_avx2.cpp.
+        */
+        void addLeavesAVX2(const float *leaves, int leafStride, const int *leafIds, int count, int size, float *dst);
+#endif
+
+#ifdef DEST_WITH_AVX512
+        /**
+            Walk blocks of sixteen trees using AVX-512, see forest_avx512.cpp.
+            \returns the number of trees walked.
+        */
+        int walkTreesAVX512(const int *splits, int numSplitsPerTree, int numTests, int firstTree, int count, const float *pixels, int numLeavesPerTree, int *leafIds);
+
+        /**
+            Add float residuals of leaves to destination in order using AVX-512, see forest_avx512.cpp.
+        */
+        void addLeavesAVX512(const float *leaves, int leafStride, const int *leafIds, int count, int size, float *dst);
+#endif
+
+        /**
+            Advance from node n to its child.
+
+            Branch free: the child is 2n+1 when the split test passes and 2n+2 otherwise.
+        */
+        template<class Split, class Pixel>
+        inline int walkStep(const Split *s, const Pixel *pixels, int n) {
+            const Split &split = s[n];
+            return 2 * n + 2 - static_cast<int>(pixels[split.idx1] - pixels[split.idx2] > split.threshold);
+        }
+
+        /**
+            Tree walk with the number of split tests fixed at compile time. Fully unrolled.
+        */
+        template<int NumTests>
+        struct FixedTreeWalk {
+            template<class Split, class Pixel>
+            static int walk(const Split *s, const Pixel *pixels, int n) {
+                return FixedTreeWalk<NumTests - 1>::walk(s, pixels, walkStep(s, pixels, n));
+            }
+        };
+
+        template<>
+        struct FixedTreeWalk<0> {
+            template<class Split, class Pixel>
+            static int walk(const Split *, const Pixel *, int n) {
+                return n;
+            }
+        };
+
+        /**
+            Tree walk with the number of split tests known at runtime only.
+        */
+        struct DynamicTreeWalk {
+            int numTests;
+
+            DynamicTreeWalk(int numTests_)
+            : numTests(numTests_)
+            {}
+
+            template<class Split, class Pixel>
+            int walk(const Split *s, const Pixel *pixels, int n) const {
+                for (int i = 0; i < numTests; ++i) {
+                    n = walkStep(s, pixels, n);
+                }
+                return n;
+            }
+        };
+
+        /**
+            Index of lowest set bit. Value must not be zero.
+        */
+        inline int lowestBit(uint64_t v) {
+#if defined(_MSC_VER) && defined(_WIN64)
+            unsigned long i;
+            _BitScanForward64(&i, v);
+            return static_cast<int>(i);
+#elif defined(__GNUC__)
+            return __builtin_ctzll(v);
+#else
+            int i = 0;
+            while (!(v & 1)) {
+                v >>= 1;
+                ++i;
+            }
+            return i;
+#endif
+        }
+
+        struct Forest::data {
+
+            struct Split {
+                int idx1;
+                int idx2;
+                float threshold;
+            };
+
+            /** Split test on fixed point intensities. */
+            struct FixedSplit {
+                int idx1;
+                int idx2;
+                int threshold;
+            };
+
+            /** Split test in bitvector layout. */
+            struct BitNode {
+                float threshold;
+                int tree;
+                uint64_t mask;
+            };
+
+            /** Split tests sharing the same pixel pair, sorted by decreasing threshold. */
+            struct Feature {
+                int idx1;
+                int idx2;
+                int firstNode;
+                int endNode;
+            };
+
+            /** Consecutive trees evaluated together in bitvector layout. */
+            struct Block {
+                int firstTree;
+                int numTrees;
+                int firstFeature;
+                int endFeature;
+            };
+
+            enum {
+                /** Maximum number of trees per block. */
+                BlockSize = 256,
+                /** Maximum depth supported by bitvector layout. */
+                MaxBitVectorDepth = 7
+            };
+
+            typedef Eigen::Matrix<int16_t, Eigen::Dynamic, Eigen::Dynamic> MatrixInt16;
+            typedef Eigen::Matrix<uint16_t, Eigen::Dynamic, Eigen::Dynamic> MatrixFloat16;
+
+            std::vector<Split> splits;
+            std::vector<FixedSplit> fixedSplits;
+            int maxFixedPixelIndex;
+            Eigen::MatrixXf leaves;
+            MatrixInt16 leavesInt16;
+            MatrixFloat16 leavesFloat16;
+            float leafScale;
+            LeafEncoding encoding;
+            Eigen::MatrixXf basis;
+            int leafSize;
+            int numTrees;
+            int depth;
+            int numSplitsPerTree;
+            int numLeavesPerTree;
+
+            ForestEvaluation evaluation;
+            std::vector<BitNode> bitNodes;
+            std::vector<Feature> features;
+            std::vector<Block> blocks;
+
+            data()
+            : maxFixedPixelIndex(0), leafScale(1.f), encoding(LeafEncoding_Float32), leafSize(0), numTrees(0), depth(1), numSplitsPerTree(0), numLeavesPerTree(1), evaluation(ForestEvaluation_TreeWalk)
+            {}
+
+            /**
+                Add float residuals of leaves to destination in order.
+
+                Instantiated with the residual size of common landmark counts, so that the
+                accumulation is vectorized with a trip count known at compile time. Only used
+                when no AVX2 or AVX-512 kernel is available at runtime.
+            */
+            template<int Size>
+            void addLeavesFloat32(const int *leafIds, int count, float *dst) const {
+                typedef Eigen::Matrix<float, Size, 1> Residual;
+
+                Eigen::Map<Residual> r(dst, leafSize);
+                for (int i = 0; i < count; ++i) {
+                    r += Eigen::Map<const Residual>(leaves.col(leafIds[i]).data(), leafSize);
+                }
+            }
+
+            /**
+                Add residuals of leaves to destination in order.
+            */
+            void addLeaves(const int *leafIds, int count, float *dst) const {
+                Eigen::Map<Eigen::VectorXf> r(dst, leafSize);
+
+                switch (encoding) {
+                    case LeafEncoding_Int16:
+                        for (int i = 0; i < count; ++i) {
+                            r += leafScale * leavesInt16.col(leafIds[i]).cast<float>();
+                        }
+                        break;
+                    case LeafEncoding_Float16:
+                        for (int i = 0; i < count; ++i) {
+                            const uint16_t *q = leavesFloat16.col(leafIds[i]).data();
+                            for (int j = 0; j < leafSize; ++j) {
+                                dst[j] += leafScale * util::fromFloat16Finite(q[j]);
+                            }
+                        }
+                        break;
+                    default:
+#ifdef DEST_WITH_AVX512
+                        if (util::simdLevel() >= util::SimdLevel_AVX512) {
+                            addLeavesAVX512(leaves.data(), static_cast<int>(leaves.rows()), leafIds, count, leafSize, dst);
+                            break;
+                        }
+#endif
+#ifdef DEST_WITH_AVX2
+                        if (util::simdLevel() >= util::SimdLevel_AVX2) {
+                            addLeavesAVX2(leaves.data(), static_cast<int>(leaves.rows()), leafIds, count, leafSize, dst);
+                            break;
+                        }
+#endif
+                        // Fallback without wide SIMD: specializations for 58 (IMM), 68 (iBUG) and 74 (LAND) landmarks.
+                        switch (leafSize) {
+                            case 2 * 58: addLeavesFloat32<2 * 58>(leafIds, count, dst); break;
+                            case 2 * 68: addLeavesFloat32<2 * 68>(leafIds, count, dst); break;
+                            case 2 * 74: addLeavesFloat32<2 * 74>(leafIds, count, dst); break;
+                            default: addLeavesFloat32<Eigen::Dynamic>(leafIds, count, dst); break;
+                        }
+                        break;
+                }
+            }
+
+            /**
+                Convert packed float leaves to requested encoding and apply the learning rate.
+
+                Leaves already quantized with the given scale are stored without further loss.
+                A non-positive scale quantizes the leaves first. The learning rate is folded
+                into the common scale of quantized leaves.
+            */
+            void encodeLeaves(LeafEncoding e, float scale, float learningRate) {
+                encoding = e;
+                leafScale = 1.f;
+                leavesInt16.resize(0, 0);
+                leavesFloat16.resize(0, 0);
+
+                if (e == LeafEncoding_Float32) {
+                    leaves *= learningRate;
+                    return;
+                }
+
+                if (scale <= 0.f) {
+                    scale = quantizeLeaves(leaves, e);
+                }
+                leafScale = learningRate * scale;
+
+                if (e == LeafEncoding_Int16) {
+                    leavesInt16 = (leaves / scale).array().round().cast<int16_t>().matrix();
+                } else {
+                    leavesFloat16 = leaves.unaryExpr([scale](float v) { return util::toFloat16(v / scale); });
+                }
+                leaves.resize(0, 0);
+            }
+
+            /**
+                Accumulate the leaf residuals reached in all trees.
+            */
+            template<class Walker, class SplitType, class Pixel>
+            void predict(const Walker &walker, const std::vector<SplitType> &splits, const Pixel *pixels, Eigen::Map<Eigen::VectorXf> &residual, int numUsed) const {
+                int leafIds[BlockSize];
+
+                for (int first = 0; first < numUsed; first += BlockSize) {
+                    const int count = std::min<int>(BlockSize, numUsed - first);
+                    walkBlock(walker, splits, first, count, pixels, leafIds);
+                    addLeaves(leafIds, count, residual.data());
+                }
+            }
+
+            /**
+                Accumulate the leaf residuals reached in all trees for multiple shapes.
+            */
+            template<class Walker, class SplitType, class Pixels>
+            void predict(const Walker &walker, const std::vector<SplitType> &splits, const Pixels &intensities, Eigen::MatrixXf &residuals, int numUsed) const {
+                int leafIds[BlockSize];
+                const int numShapes = static_cast<int>(intensities.cols());
+
+                for (int first = 0; first < numUsed; first += BlockSize) {
+                    const int count = std::min<int>(BlockSize, numUsed - first);
+                    for (int i = 0; i < numShapes; ++i) {
+                        walkBlock(walker, splits, first, count, intensities.col(i).data(), leafIds);
+                        addLeaves(leafIds, count, residuals.col(i).data());
+                    }
+                }
+            }
+
+            /**
+                Find exit leaves of consecutive trees.
+            */
+            template<class Walker, class SplitType, class Pixel>
+            void walkBlock(const Walker &walker, const std::vector<SplitType> &splits, int first, int count, const Pixel *pixels, int *leafIds) const {
+                for (int t = walkBlockSIMD(splits, first, count, pixels, leafIds); t < count; ++t) {
+                    const int tree = first + t;
+                    const int n = walker.walk(splits.data() + tree * numSplitsPerTree, pixels, 0);
+                    leafIds[t] = tree * numLeavesPerTree + (n - numSplitsPerTree);
+                }
+            }
+
+            /**
+                Find exit leaves of leading trees of a block with the widest available SIMD kernel.
+                \returns the number of trees walked.
+            */
+            int walkBlockSIMD(const std::vector<Split> &splits, int first, int count, const float *pixels, int *leafIds) const {
+                static_assert(sizeof(Split) == 3 * sizeof(int), "Kernels expect splits packed as triplets");
+                const int *s = reinterpret_cast<const int*>(splits.data());
+#ifdef DEST_WITH_AVX512
+                if (util::simdLevel() >= util::SimdLevel_AVX512)
+                    return walkTreesAVX512(s, numSplitsPerTree, depth - 1, first, count, pixels, numLeavesPerTree, leafIds);
+#endif
+#ifdef DEST_WITH_AVX2
+                if (util::simdLevel() >= util::SimdLevel_AVX2)
+                    return walkTreesAVX2(s, numSplitsPerTree, depth - 1, first, count, pixels, numLeavesPerTree, leafIds);
+#endif
+                (void)s;
+                return 0;
+            }
+
+            /**
+                Find exit leaves of leading trees of a block on fixed point intensities.
+                \returns the number of trees walked.
+            */
+            int walkBlockSIMD(const std::vector<FixedSplit> &splits, int first, int count, const short *pixels, int *leafIds) const {
+                static_assert(sizeof(FixedSplit) == 3 * sizeof(int), "Kernels expect splits packed as triplets");
+                const int *s = reinterpret_cast<const int*>(splits.data());
+#ifdef DEST_WITH_AVX2
+                if (util::simdLevel() >= util::SimdLevel_AVX2)
+                    return walkTreesFixedAVX2(s, numSplitsPerTree, depth - 1, first, count, pixels, maxFixedPixelIndex, numLeavesPerTree, leafIds);
+#endif
+                (void)s; (void)first; (void)count; (void)pixels; (void)leafIds;
+                return 0;
+            }
+
+            /**
+                Find exit leaves of all trees in block using bitvectors.
+
+                A leaf bit is cleared for every failed test above it that would route away from it.
+                Since leaves are ordered from left to right, the exit leaf is the lowest remaining bit.
+            */
+            void findExitLeaves(const Block &b, const float *pixels, uint64_t *bits, int *leafIds) const {
+                std::fill(bits, bits + b.numTrees, ~uint64_t(0));
+
+                for (int f = b.firstFeature; f < b.endFeature; ++f) {
+                    const Feature &feature = features[f];
+                    const float value = pixels[feature.idx1] - pixels[feature.idx2];
+
+                    // Nodes are sorted by decreasing threshold, so failed tests come first.
+                    for (int n = feature.firstNode; n < feature.endNode && !(value > bitNodes[n].threshold); ++n) {
+                        bits[bitNodes[n].tree] &= bitNodes[n].mask;
+                    }
+                }
+
+                for (int t = 0; t < b.numTrees; ++t) {
+                    leafIds[t] = (b.firstTree + t) * numLeavesPerTree + lowestBit(bits[t]);
+                }
+            }
+
+            /**
+                Accumulate the leaf residuals reached in all trees using bitvectors.
+            */
+            void predictBitVector(const float *pixels, Eigen::Map<Eigen::VectorXf> &residual, int numUsed) const {
+                uint64_t bits[BlockSize];
+                int leafIds[BlockSize];
+
+                for (size_t i = 0; i < blocks.size() && blocks[i].firstTree < numUsed; ++i) {
+                    const Block &b = blocks[i];
+                    findExitLeaves(b, pixels, bits, leafIds);
+                    addLeaves(leafIds, std::min<int>(b.numTrees, numUsed - b.firstTree), residual.data());
+                }
+            }
+
+            /**
+                Accumulate the leaf residuals reached in all trees for multiple shapes using bitvectors.
+            */
+            void predictBitVector(const Eigen::MatrixXf &intensities, Eigen::MatrixXf &residuals, int numUsed) const {
+                uint64_t bits[BlockSize];
+                int leafIds[BlockSize];
+                const int numShapes = static_cast<int>(intensities.cols());
+
+                for (size_t i = 0; i < blocks.size() && blocks[i].firstTree < numUsed; ++i) {
+                    const Block &b = blocks[i];
+                    const int count = std::min<int>(b.numTrees, numUsed - b.firstTree);
+                    for (int s = 0; s < numShapes; ++s) {
+                        findExitLeaves(b, intensities.col(s).data(), bits, leafIds);
+                        addLeaves(leafIds, count, residuals.col(s).data());
+                    }
+                }
+            }
+
+            /**
+                Accumulate the leaf residuals reached in all trees, specialized for common depths.
+            */
+            template<class SplitType, class Pixels, class Residuals>
+            void predictTreeWalk(const std::vector<SplitType> &splits, const Pixels &pixels, Residuals &residuals, int numUsed) const {
+                switch (depth) {
+                    case 3: predict(FixedTreeWalk<2>(), splits, pixels, residuals, numUsed); break;
+                    case 4: predict(FixedTreeWalk<3>(), splits, pixels, residuals, numUsed); break;
+                    case 5: predict(FixedTreeWalk<4>(), splits, pixels, residuals, numUsed); break;
+                    case 6: predict(FixedTreeWalk<5>(), splits, pixels, residuals, numUsed); break;
+                    default: predict(DynamicTreeWalk(depth - 1), splits, pixels, residuals, numUsed); break;
+                }
+            }
+
+            /**
+                Number of leading trees to evaluate when limited to maxTrees. Zero uses all trees.
+            */
+            int treesUsed(int maxTrees) const {
+                return (maxTrees > 0 && maxTrees < numTrees) ? maxTrees : numTrees;
+            }
+
+            /**
+                Accumulate the leaf residuals of a single shape.
+
+                When leaves are compressed, leaf coefficients are summed first and expanded
+                by the basis once.
+            */
+            template<class SplitType, class Pixel>
+            void predictShape(const std::vector<SplitType> &splits, const Pixel *pixels, float *residual, int numUsed) const {
+                if (basis.size() == 0) {
+                    Eigen::Map<Eigen::VectorXf> r(residual, leafSize);
+                    predictLeaves(splits, pixels, r, numUsed);
+                } else {
+                    float coefficients[MaxLeafComponents];
+                    Eigen::Map<Eigen::VectorXf> c(coefficients, leafSize);
+                    c.setZero();
+                    predictLeaves(splits, pixels, c, numUsed);
+
+                    Eigen::Map<Eigen::VectorXf> r(residual, basis.rows());
+                    r.noalias() += basis * c;
+                }
+            }
+
+            void predictLeaves(const std::vector<Split> &splits, const float *pixels, Eigen::Map<Eigen::VectorXf> &residual, int numUsed) const {
+                if (evaluation == ForestEvaluation_BitVector) {
+                    predictBitVector(pixels, residual, numUsed);
+                } else {
+                    predictTreeWalk(splits, pixels, residual, numUsed);
+                }
+            }
+
+            void predictLeaves(const std::vector<FixedSplit> &splits, const short *pixels, Eigen::Map<Eigen::VectorXf> &residual, int numUsed) const {
+                predictTreeWalk(splits, pixels, residual, numUsed);
+            }
+
+            /**
+                Accumulate the leaf residuals of multiple shapes with compressed leaves.
+
+                Coefficients are accumulated in a fixed size buffer, so shapes are processed one
+                after another.
+            */
+            template<class SplitType, class Pixels>
+            void predictCompressedShapes(const std::vector<SplitType> &splits, const Pixels &intensities, Eigen::MatrixXf &residuals, int numUsed) const {
+                const int numShapes = static_cast<int>(intensities.cols());
+                for (int i = 0; i < numShapes; ++i) {
+                    predictShape(splits, intensities.col(i).data(), residuals.col(i).data(), numUsed);
+                }
+            }
+
+            /**
+                Derive split tests on fixed point intensities from packed split tests.
+
+                For integer differences d, d > t holds exactly when d > floor(t).
+            */
+            void buildFixedSplits() {
+                const float one = static_cast<float>(1 << FixedIntensityFractionBits);
+                const float limit = 65536.f;
+
+                fixedSplits.resize(splits.size());
+                maxFixedPixelIndex = 0;
+                for (size_t i = 0; i < splits.size(); ++i) {
+                    fixedSplits[i].idx1 = splits[i].idx1;
+                    fixedSplits[i].idx2 = splits[i].idx2;
+                    maxFixedPixelIndex = std::max<int>(maxFixedPixelIndex, std::max<int>(splits[i].idx1, splits[i].idx2));
+fixedSplits[i].threshold = static_cast<int>(std::floor(std::max<float>(-limit, std::min<float>(limit, splits[i].threshold * one))));
+                }
+            }
+
+            /**
+                Derive bitvector layout from packed split tests.
+            */
+            void buildBitVectors() {
+                bitNodes.clear();
+                features.clear();
+                blocks.clear();
+
+                struct Test {
+                    int idx1, idx2;
+                    BitNode node;
+
+                    bool operator<(const Test &other) const {
+                        if (idx1 != other.idx1) return idx1 < other.idx1;
+                        if (idx2 != other.idx2) return idx2 < other.idx2;
+                        return node.threshold > other.node.threshold;
+                    }
+                };
+
+                std::vector<Test> tests;
+                for (int first = 0; first < numTrees; first += BlockSize) {
+                    Block b;
+                    b.firstTree = first;
+                    b.numTrees = std::min<int>(BlockSize, numTrees - first);
+                    b.firstFeature = static_cast<int>(features.size());
+
+                    tests.clear();
+                    for (int t = 0; t < b.numTrees; ++t) {
+                        const Split *s = splits.data() + (first + t) * numSplitsPerTree;
+                        for (int n = 0, level = 0; n < numSplitsPerTree; ++n) {
+                            if (n + 1 == (2 << level)) {
+                                ++level;
+                            }
+
+                            // Tests of completed premature leaves never fail.
+                            if (s[n].threshold == -std::numeric_limits<float>::max())
+                                continue;
+
+                            // Failing the test excludes all leaves of the left subtree.
+                            const int leafLevel = depth - 1;
+                            const int numExcluded = 1 << (leafLevel - level - 1);
+                            const int firstExcluded = (n - ((1 << level) - 1)) << (leafLevel - level);
+
+                            Test test;
+                            test.idx1 = s[n].idx1;
+                            test.idx2 = s[n].idx2;
+                            test.node.threshold = s[n].threshold;
+                            test.node.tree = t;
+                            test.node.mask = ~(((uint64_t(1) << numExcluded) - 1) << firstExcluded);
+                            tests.push_back(test);
+                        }
+                    }
+
+                    std::sort(tests.begin(), tests.end());
+
+                    for (size_t i = 0; i < tests.size(); ++i) {
+                        if (i == 0 || tests[i].idx1 != tests[i - 1].idx1 || tests[i].idx2 != tests[i - 1].idx2) {
+                            Feature f;
+                            f.idx1 = tests[i].idx1;
+                            f.idx2 = tests[i].idx2;
+                            f.firstNode = static_cast<int>(bitNodes.size());
+                            features.push_back(f);
+                        }
+                        bitNodes.push_back(tests[i].node);
+                        features.back().endNode = static_cast<int>(bitNodes.size());
+                    }
+
+                    b.endFeature = static_cast<int>(features.size());
+                    blocks.push_back(b);
+                }
+            }
+
+            /**
+                Recursively copy tree node into full tree layout.
+            */
+            void packNode(const Tree &t, int treeIdx, int node, int level, const Eigen::MatrixXf &values, int &nextValue, int premature) {
+                int idx1, idx2;
+                float threshold;
+                bool isSplit = premature < 0 && level < t.depth() && t.nodeSplit(node, idx1, idx2, threshold);
+
+                if (!isSplit && premature < 0 && level < depth) {
+                    // Premature leaf, complete subtree using its residual.
+                    premature = nextValue++;
+                }
+
+                if (level < depth) {
+                    Split &split = splits[treeIdx * numSplitsPerTree + node];
+                    if (premature >= 0) {
+                        // Always branch left.
+                        split.idx1 = 0;
+                        split.idx2 = 0;
+                        split.threshold = -std::numeric_limits<float>::max();
+                    } else {
+                        split.idx1 = idx1;
+                        split.idx2 = idx2;
+                        split.threshold = threshold;
+                    }
+
+                    packNode(t, treeIdx, 2 * node + 1, level + 1, values, nextValue, premature);
+                    packNode(t, treeIdx, 2 * node + 2, level + 1, values, nextValue, premature);
+                } else {
+                    // Leaves are visited from left to right, matching the order of Tree::collectLeafMeans.
+                    const int value = (premature >= 0) ? premature : nextValue++;
+                    const int leaf = treeIdx * numLeavesPerTree + (node - numSplitsPerTree);
+                    leaves.col(leaf) = values.col(value);
+                }
+            }
+        };
+
+        Forest::Forest()
+        : _data(new data())
+        {}
+
+        Forest::Forest(const Forest &other)
+        : _data(new data(*other._data))
+        {}
+
+        Forest::~Forest()
+        {}
+
+        Forest &Forest::operator=(const Forest &other)
+        {
+            *_data = *other._data;
+            return *this;
+        }
+
+        float quantizeLeaves(Eigen::MatrixXf &values, LeafEncoding encoding)
+        {
+            if (encoding == LeafEncoding_Float32)
+                return 1.f;
+
+            // Normalize by largest magnitude to make best use of the 16 bit range.
+            const float maxAbs = (values.size() > 0) ? values.cwiseAbs().maxCoeff() : 0.f;
+
+            // Dequantization matches io::fromFbs, so quantized leaves survive saving unchanged.
+            if (encoding == LeafEncoding_Int16) {
+                const float scale = (maxAbs > 0.f) ? maxAbs / 32767.f : 1.f;
+                values = values.unaryExpr([scale](float v) { return static_cast<float>(static_cast<int16_t>(std::round(v / scale))) * scale; });
+                return scale;
+            } else {
+                const float scale = (maxAbs > 0.f) ? maxAbs : 1.f;
+                values = values.unaryExpr([scale](float v) { return util::fromFloat16(util::toFloat16(v / scale)) * scale; });
+                return scale;
+            }
+        }
+
+        void Forest::build(const std::vector<Tree> &trees, float learningRate, ForestEvaluation evaluation, LeafEncoding encoding, const Eigen::MatrixXf *leafBasis, const Eigen::MatrixXf *leafValues, float leafScale)
+        {
+            data &d = *_data;
+
+            d.numTrees = static_cast<int>(trees.size());
+            d.depth = 1;
+            for (size_t i = 0; i < trees.size(); ++i) {
+                d.depth = std::max<int>(d.depth, trees[i].depth());
+            }
+
+            d.numLeavesPerTree = 1 << (d.depth - 1);
+            d.numSplitsPerTree = d.numLeavesPerTree - 1;
+
+            d.basis.resize(0, 0);
+            if (leafBasis && leafBasis->cols() > 0) {
+                eigen_assert(leafBasis->cols() <= MaxLeafComponents);
+                d.basis = *leafBasis;
+            }
+
+            // Values of distinct leaves, one column per leaf.
+            Eigen::MatrixXf values;
+            if (leafValues) {
+                values = *leafValues;
+            } else {
+                std::vector<ShapeResidual> means;
+                for (int i = 0; i < d.numTrees; ++i) {
+                    trees[i].collectLeafMeans(means);
+                }
+
+                values.resize(means.empty() ? 0 : means.front().size(), means.size());
+                for (size_t i = 0; i < means.size(); ++i) {
+                    values.col(i) = Eigen::Map<const Eigen::VectorXf>(means[i].data(), means[i].size());
+                }
+
+                if (d.basis.size() > 0 && values.cols() > 0) {
+                    // Replace leaf residuals by their coefficients.
+                    eigen_assert(d.basis.rows() == values.rows());
+                    values = d.basis.transpose() * values;
+                }
+            }
+
+            d.leafSize = static_cast<int>(values.rows());
+            d.splits.resize(d.numTrees * d.numSplitsPerTree);
+            d.leaves.resize(d.leafSize, d.numTrees * d.numLeavesPerTree);
+
+            int nextValue = 0;
+            for (int i = 0; i < d.numTrees; ++i) {
+                d.packNode(trees[i], i, 0, 1, values, nextValue, -1);
+            }
+            eigen_assert(nextValue == values.cols());
+
+            d.encodeLeaves(encoding, leafScale, learningRate);
+
+            d.evaluation = evaluation;
+            if (d.evaluation == ForestEvaluation_BitVector && d.depth > data::MaxBitVectorDepth) {
+                d.evaluation = ForestEvaluation_TreeWalk;
+            }
+
+            d.bitNodes.clear();
+            d.features.clear();
+            d.blocks.clear();
+            d.fixedSplits.clear();
+
+            if (d.evaluation == ForestEvaluation_BitVector) {
+                d.buildBitVectors();
+            } else if (d.evaluation == ForestEvaluation_FixedPoint) {
+                d.buildFixedSplits();
+            }
+        }
+
+        void Forest::predict(const PixelIntensities &intensities, ShapeResidual &residual, int maxTrees) const
+        {
+            const data &d = *_data;
+            d.predictShape(d.splits, intensities.data(), residual.data(), d.treesUsed(maxTrees));
+        }
+
+        void Forest::predict(const Eigen::MatrixXf &intensities, Eigen::MatrixXf &residuals, int maxTrees) const
+        {
+            const data &d = *_data;
+
+            if (d.basis.size() > 0) {
+                d.predictCompressedShapes(d.splits, intensities, residuals, d.treesUsed(maxTrees));
+            } else if (d.evaluation == ForestEvaluation_BitVector) {
+                d.predictBitVector(intensities, residuals, d.treesUsed(maxTrees));
+            } else {
+                d.predictTreeWalk(d.splits, intensities, residuals, d.treesUsed(maxTrees));
+            }
+        }
+
+        void Forest::predict(const FixedPixelIntensities &intensities, ShapeResidual &residual, int maxTrees) const
+        {
+            const data &d = *_data;
+            eigen_assert(d.evaluation == ForestEvaluation_FixedPoint);
+
+            d.predictShape(d.fixedSplits, intensities.data(), residual.data(), d.treesUsed(maxTrees));
+        }
+
+        void Forest::predict(const FixedPixelIntensitiesMatrix &intensities, Eigen::MatrixXf &residuals, int maxTrees) const
+        {
+            const data &d = *_data;
+            eigen_assert(d.evaluation == ForestEvaluation_FixedPoint);
+
+            if (d.basis.size() > 0) {
+                d.predictCompressedShapes(d.fixedSplits, intensities, residuals, d.treesUsed(maxTrees));
+            } else {
+                d.predictTreeWalk(d.fixedSplits, intensities, residuals, d.treesUsed(maxTrees));
+            }
+        }
+
+        int Forest::numTrees() const
+        {
+            return _data->numTrees;
+        }
+
+        int Forest::depth() const
+        {
+            return _data->depth;
+        }
+
+        ForestEvaluation Forest::evaluation() const
+        {
+            return _data->evaluation;
+        }
+
+        LeafEncoding Forest::leafEncoding() const
+        {
+            return _data->encoding;
+        }
+
+        int Forest::numLeafComponents() const
+        {
+            return static_cast<int>(_data->basis.cols());
+        }
+
+    }
+}
@@ -0,0 +1,151 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+/*
+    AVX2 forest evaluation kernels.
+
+    Same constraints as image_avx2.cpp apply: entered only after a runtime CPU check
+    and restricted to raw pointers.
+*/
+
+#include <dest/core/config.h>
+
+#ifdef DEST_WITH_AVX2
+
+#include <immintrin.h>
+
+namespace dest {
+    namespace core {
+        
+        int walkTreesAVX2(const int *splits, int numSplitsPerTree, int numTests, int firstTree, int count, const float *pixels, int numLeavesPerTree, int *leafIds)
+        {
+            // Splits are stored as (idx1, idx2, threshold) triplets. Eight trees are walked
+            // in lockstep, each lane following the same branch free rule as walkStep.
+            const float *thresholds = reinterpret_cast<const float*>(splits + 2);
+            const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            const __m256i two = _mm256_set1_epi32(2);
+            const __m256i three = _mm256_set1_epi32(3);
+            
+            const int numBlocks = count / 8;
+            for (int b = 0; b < numBlocks; ++b) {
+                const __m256i tree = _mm256_add_epi32(_mm256_set1_epi32(firstTree + b * 8), lanes);
+                const __m256i treeBase = _mm256_mullo_epi32(tree, _mm256_set1_epi32(numSplitsPerTree));
+                
+                __m256i n = _mm256_setzero_si256();
+                for (int k = 0; k < numTests; ++k) {
+                    const __m256i s = _mm256_mullo_epi32(_mm256_add_epi32(treeBase, n), three);
+                    const __m256i idx1 = _mm256_i32gather_epi32(splits, s, 4);
+                    const __m256i idx2 = _mm256_i32gather_epi32(splits + 1, s, 4);
+                    const __m256 threshold = _mm256_i32gather_ps(thresholds, s, 4);
+                    const __m256 d = _mm256_sub_ps(_mm256_i32gather_ps(pixels, idx1, 4), _mm256_i32gather_ps(pixels, idx2, 4));
+                    
+                    // Passed tests yield all bits set, i.e. -1.
+                    const __m256i passed = _mm256_castps_si256(_mm256_cmp_ps(d, threshold, _CMP_GT_OQ));
+                    n = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(n, n), two), passed);
+                }
+                
+                const __m256i leaf = _mm256_add_epi32(_mm256_mullo_epi32(tree, _mm256_set1_epi32(numLeavesPerTree)), 
+                                                      _mm256_sub_epi32(n, _mm256_set1_epi32(numSplitsPerTree)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(leafIds + b * 8), leaf);
+            }
+            
+            return numBlocks * 8;
+        }
+        
+        int walkTreesFixedAVX2(const int *splits, int numSplitsPerTree, int numTests, int firstTree, int count, const short *pixels, int maxPixelIndex, int numLeavesPerTree, int *leafIds)
+        {
+            // Gathers load 32 bit words, so each lane reads the addressed intensity and the one
+            // following it. Lanes addressing the last used intensity load the word ending at it
+            // instead, so no lane reads beyond the intensities.
+            if (maxPixelIndex < 1)
+                return 0;
+            
+            const int *base = reinterpret_cast<const int*>(pixels);
+            const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i two = _mm256_set1_epi32(2);
+            const __m256i three = _mm256_set1_epi32(3);
+            const __m256i sixteen = _mm256_set1_epi32(16);
+            const __m256i lastSafe = _mm256_set1_epi32(maxPixelIndex - 1);
+            
+            const int numBlocks = count / 8;
+            for (int b = 0; b < numBlocks; ++b) {
+                const __m256i tree = _mm256_add_epi32(_mm256_set1_epi32(firstTree + b * 8), lanes);
+                const __m256i treeBase = _mm256_mullo_epi32(tree, _mm256_set1_epi32(numSplitsPerTree));
+                
+                __m256i n = _mm256_setzero_si256();
+                for (int k = 0; k < numTests; ++k) {
+                    const __m256i s = _mm256_mullo_epi32(_mm256_add_epi32(treeBase, n), three);
+                    const __m256i threshold = _mm256_i32gather_epi32(splits + 2, s, 4);
+                    
+                    __m256i p[2];
+                    for (int j = 0; j < 2; ++j) {
+                        const __m256i idx = _mm256_i32gather_epi32(splits + j, s, 4);
+                        const __m256i atEnd = _mm256_cmpgt_epi32(idx, lastSafe);
+                        const __m256i v = _mm256_i32gather_epi32(base, _mm256_sub_epi32(idx, _mm256_and_si256(atEnd, one)), 2);
+                        // Move the addressed intensity to the upper half and sign extend.
+                        p[j] = _mm256_srai_epi32(_mm256_sllv_epi32(v, _mm256_andnot_si256(atEnd, sixteen)), 16);
+                    }
+                    
+                    // Passed tests yield all bits set, i.e. -1.
+                    const __m256i passed = _mm256_cmpgt_epi32(_mm256_sub_epi32(p[0], p[1]), threshold);
+                    n = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(n, n), two), passed);
+                }
+                
+                const __m256i leaf = _mm256_add_epi32(_mm256_mullo_epi32(tree, _mm256_set1_epi32(numLeavesPerTree)), 
+                                                      _mm256_sub_epi32(n, _mm256_set1_epi32(numSplitsPerTree)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(leafIds + b * 8), leaf);
+            }
+            
+            return numBlocks * 8;
+        }
+        
+        void addLeavesAVX2(const float *leaves, int leafStride, const int *leafIds, int count, int size, float *dst)
+        {
+            // The residual is processed in chunks that fit into registers, so every leaf
+            // value is loaded once and the destination is written once per chunk. Leaves
+            // are added in order, which keeps results identical to the scalar code.
+            const int ChunkSize = 64;
+            
+            int j = 0;
+            for (; j + ChunkSize <= size; j += ChunkSize) {
+                __m256 r[8];
+                for (int k = 0; k < 8; ++k)
+                    r[k] = _mm256_loadu_ps(dst + j + k * 8);
+                
+                for (int i = 0; i < count; ++i) {
+                    const float *l = leaves + static_cast<long long>(leafIds[i]) * leafStride + j;
+                    for (int k = 0; k < 8; ++k)
+                        r[k] = _mm256_add_ps(r[k], _mm256_loadu_ps(l + k * 8));
+                }
+                
+                for (int k = 0; k < 8; ++k)
+                    _mm256_storeu_ps(dst + j + k * 8, r[k]);
+            }
+            
+            for (; j + 8 <= size; j += 8) {
+                __m256 r = _mm256_loadu_ps(dst + j);
+                for (int i = 0; i < count; ++i)
+                    r = _mm256_add_ps(r, _mm256_loadu_ps(leaves + static_cast<long long>(leafIds[i]) * leafStride + j));
+                _mm256_storeu_ps(dst + j, r);
+            }
+            
+            for (; j < size; ++j) {
+                float r = dst[j];
+                for (int i = 0; i < count; ++i)
+                    r += leaves[static_cast<long long>(leafIds[i]) * leafStride + j];
+                dst[j] = r;
+            }
+        }
+        
+    }
+}
+
+#endif
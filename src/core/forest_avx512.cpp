@@ -0,0 +1,102 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+/*
+    AVX-512 forest evaluation kernels.
+
+    Same constraints as image_avx2.cpp apply: entered only after a runtime CPU check
+    and restricted to raw pointers.
+*/
+
+#include <dest/core/config.h>
+
+#ifdef DEST_WITH_AVX512
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC 12 headers build undefined source operands from self initialized variables, which
+// -Wmaybe-uninitialized reports once intrinsics are inlined (GCC bug 105593).
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace dest {
+    namespace core {
+        
+        int walkTreesAVX512(const int *splits, int numSplitsPerTree, int numTests, int firstTree, int count, const float *pixels, int numLeavesPerTree, int *leafIds)
+        {
+            // See walkTreesAVX2. Sixteen trees are walked in lockstep.
+            const float *thresholds = reinterpret_cast<const float*>(splits + 2);
+            const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+            const __m512i one = _mm512_set1_epi32(1);
+            const __m512i two = _mm512_set1_epi32(2);
+            const __m512i three = _mm512_set1_epi32(3);
+            
+            const int numBlocks = count / 16;
+            for (int b = 0; b < numBlocks; ++b) {
+                const __m512i tree = _mm512_add_epi32(_mm512_set1_epi32(firstTree + b * 16), lanes);
+                const __m512i treeBase = _mm512_mullo_epi32(tree, _mm512_set1_epi32(numSplitsPerTree));
+                
+                __m512i n = _mm512_setzero_si512();
+                for (int k = 0; k < numTests; ++k) {
+                    const __m512i s = _mm512_mullo_epi32(_mm512_add_epi32(treeBase, n), three);
+                    const __m512i idx1 = _mm512_i32gather_epi32(s, splits, 4);
+                    const __m512i idx2 = _mm512_i32gather_epi32(s, splits + 1, 4);
+                    const __m512 threshold = _mm512_i32gather_ps(s, thresholds, 4);
+                    const __m512 d = _mm512_sub_ps(_mm512_i32gather_ps(idx1, pixels, 4), _mm512_i32gather_ps(idx2, pixels, 4));
+                    
+                    const __mmask16 passed = _mm512_cmp_ps_mask(d, threshold, _CMP_GT_OQ);
+                    const __m512i right = _mm512_add_epi32(_mm512_add_epi32(n, n), two);
+                    n = _mm512_mask_sub_epi32(right, passed, right, one);
+                }
+                
+                const __m512i leaf = _mm512_add_epi32(_mm512_mullo_epi32(tree, _mm512_set1_epi32(numLeavesPerTree)), 
+                                                      _mm512_sub_epi32(n, _mm512_set1_epi32(numSplitsPerTree)));
+                _mm512_storeu_si512(leafIds + b * 16, leaf);
+            }
+            
+            return numBlocks * 16;
+        }
+        
+        void addLeavesAVX512(const float *leaves, int leafStride, const int *leafIds, int count, int size, float *dst)
+        {
+            // See addLeavesAVX2. The remainder of the residual is handled with masked loads.
+            const int ChunkSize = 128;
+            
+            int j = 0;
+            for (; j + ChunkSize <= size; j += ChunkSize) {
+                __m512 r[8];
+                for (int k = 0; k < 8; ++k)
+                    r[k] = _mm512_loadu_ps(dst + j + k * 16);
+                
+                for (int i = 0; i < count; ++i) {
+                    const float *l = leaves + static_cast<long long>(leafIds[i]) * leafStride + j;
+                    for (int k = 0; k < 8; ++k)
+                        r[k] = _mm512_add_ps(r[k], _mm512_loadu_ps(l + k * 16));
+                }
+                
+                for (int k = 0; k < 8; ++k)
+                    _mm512_storeu_ps(dst + j + k * 16, r[k]);
+            }
+            
+            for (; j < size; j += 16) {
+                const int remaining = size - j;
+                const __mmask16 m = (remaining >= 16) ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << remaining) - 1);
+                __m512 r = _mm512_maskz_loadu_ps(m, dst + j);
+                for (int i = 0; i < count; ++i)
+                    r = _mm512_add_ps(r, _mm512_maskz_loadu_ps(m, leaves + static_cast<long long>(leafIds[i]) * leafStride + j));
+                _mm512_mask_storeu_ps(dst + j, m, r);
+            }
+        }
+        
+    }
+}
+
+#endif
@@ -9,10 +9,70 @@
 */
 
 #include <dest/core/image.h>
+#include <dest/core/config.h>
+#include <dest/util/cpu.h>
 
 namespace dest {
     namespace core {
-        
+
+#ifdef DEST_WITH_AVX2
+        /** 
+            Sample blocks of eight coordinates using AVX2, see image_avx2.cpp.
+            \returns the number of coordinates processed.
+        */
+        int readImageAVX2(const unsigned char *pixels, int rows, int cols, int outerStride, const float *coords, int numCoords, float *intensities);
+
+        /** 
+            Sample blocks of eight coordinates in fixed point using AVX2, see image_avx2.cpp.
+            \returns the number of coordinates processed.
+        */
+        int readImageFixedAVX2(const unsigned char *pixels, int rows, int cols, int outerStride, const float *coords, int numCoords, int fractionBits, short *intensities);
+#endif
+
+#ifdef DEST_WITH_AVX512
+        /** 
+            Sample blocks of sixteen coordinates using AVX-512, see image_avx512.cpp.
+            \returns the number of coordinates processed.
+        */
+        int readImageAVX512(const unsigned char *pixels, int rows, int cols, int outerStride, const float *coords, int numCoords, float *intensities);
+#endif
+
+        /**
+            Sample leading coordinates with the widest available SIMD kernel.
+            \returns the number of coordinates processed.
+        */
+        inline int readImageSIMD(const Eigen::Ref<const Image> &img, const float *coords, int numCoords, float *intensities) {
+#ifdef DEST_WITH_AVX512
+            if (util::simdLevel() >= util::SimdLevel_AVX512) {
+                return readImageAVX512(img.data(), static_cast<int>(img.rows()), static_cast<int>(img.cols()), static_cast<int>(img.outerStride()),
+                                       coords, numCoords, intensities);
+            }
+#endif
+#ifdef DEST_WITH_AVX2
+            if (util::simdLevel() >= util::SimdLevel_AVX2) {
+                return readImageAVX2(img.data(), static_cast<int>(img.rows()), static_cast<int>(img.cols()), static_cast<int>(img.outerStride()),
+                                     coords, numCoords, intensities);
+            }
+#endif
+            (void)img; (void)coords; (void)numCoords; (void)intensities;
+            return 0;
+        }
+
+        /**
+            Sample leading coordinates in fixed point with the available SIMD kernel.
+            \returns the number of coordinates processed.
+        */
+        inline int readImageFixedSIMD(const Eigen::Ref<const Image> &img, const float *coords, int numCoords, short *intensities) {
+#ifdef DEST_WITH_AVX2
+            if (util::simdLevel() >= util::SimdLevel_AVX2) {
+                return readImageFixedAVX2(img.data(), static_cast<int>(img.rows()), static_cast<int>(img.cols()), static_cast<int>(img.outerStride()),
+                                          coords, numCoords, FixedIntensityFractionBits, intensities);
+            }
+#endif
+            (void)img; (void)coords; (void)numCoords; (void)intensities;
+            return 0;
+        }
+
         inline int clampToEdge(int v, Image::Index len) {
             return std::min<int>(static_cast<int>(len) - 1, std::max<int>(0, v));
         }
@@ -42,15 +102,102 @@ namespace dest {
                    (f2 * (float(1) - a) + f3 * a) * b;
         }
         
+        inline short bilinearSampleFixed(const Eigen::Ref<const Image> &img, float x, float y) {
+            
+            const int one = 1 << FixedIntensityFractionBits;
+
+            const int ix = static_cast<int>(std::floor(x));
+            const int iy = static_cast<int>(std::floor(y));
+            
+            int x0 = clampToEdge(ix, img.cols());
+            int x1 = clampToEdge(ix + 1, img.cols());
+            int y0 = clampToEdge(iy, img.rows());
+            int y1 = clampToEdge(iy + 1, img.rows());
+
+            const int a = static_cast<int>((x - (float)ix) * one + 0.5f);
+            const int b = static_cast<int>((y - (float)iy) * one + 0.5f);
+            
+            const unsigned char *ptrY0 = img.row(y0).data();
+            const unsigned char *ptrY1 = img.row(y1).data();
+            
+            const int top = ptrY0[x0] * (one - a) + ptrY0[x1] * a;
+            const int bottom = ptrY1[x0] * (one - a) + ptrY1[x1] * a;
+            
+            return static_cast<short>((top * (one - b) + bottom * b + (one >> 1)) >> FixedIntensityFractionBits);
+        }
+        
         void readImage(const Eigen::Ref<const Image> &img, const PixelCoordinates &coords, PixelIntensities &intensities) {
             const int numCoords = static_cast<int>(coords.cols());
             
             intensities.resize(coords.cols());
             
-            for (int i = 0; i < numCoords; ++i) {
+            for (int i = readImageSIMD(img, coords.data(), numCoords, intensities.data()); i < numCoords; ++i) {
                 intensities(i) = bilinearSample(img, coords(0, i), coords(1, i));
             }
         }
-        
+
+        void readImageFixed(const Eigen::Ref<const Image> &img, const PixelCoordinates &coords, FixedPixelIntensities &intensities) {
+            const int numCoords = static_cast<int>(coords.cols());
+            
+            intensities.resize(coords.cols());
+            
+            for (int i = readImageFixedSIMD(img, coords.data(), numCoords, intensities.data()); i < numCoords; ++i) {
+                intensities(i) = bilinearSampleFixed(img, coords(0, i), coords(1, i));
+            }
+        }
+
+        void readImage(const Eigen::Ref<const Image> &img, const Eigen::Matrix2f &linear, const Eigen::Ref<const PixelCoordinates> &offsets, const Eigen::Ref<const Eigen::VectorXi> &anchorIds, const PixelCoordinates &anchors, PixelIntensities &intensities) {
+            // Locations are computed in blocks small enough to stay in L1 cache, which lets
+            // the vectorized sampler run on each block.
+            const int BlockSize = 64;
+            float coords[2 * BlockSize];
+
+            const int numCoords = static_cast<int>(offsets.cols());
+            intensities.resize(numCoords);
+
+            for (int first = 0; first < numCoords; first += BlockSize) {
+                const int count = std::min<int>(BlockSize, numCoords - first);
+
+                for (int t = 0; t < count; ++t) {
+                    const int i = first + t;
+                    const float ox = offsets(0, i);
+                    const float oy = offsets(1, i);
+                    const int a = anchorIds(i);
+                    coords[2 * t + 0] = linear(0, 0) * ox + linear(0, 1) * oy + anchors(0, a);
+                    coords[2 * t + 1] = linear(1, 0) * ox + linear(1, 1) * oy + anchors(1, a);
+                }
+
+                for (int t = readImageSIMD(img, coords, count, intensities.data() + first); t < count; ++t) {
+                    intensities(first + t) = bilinearSample(img, coords[2 * t + 0], coords[2 * t + 1]);
+                }
+            }
+        }
+
+        void readImageFixed(const Eigen::Ref<const Image> &img, const Eigen::Matrix2f &linear, const Eigen::Ref<const PixelCoordinates> &offsets, const Eigen::Ref<const Eigen::VectorXi> &anchorIds, const PixelCoordinates &anchors, FixedPixelIntensities &intensities) {
+            // Blocked like readImage.
+            const int BlockSize = 64;
+            float coords[2 * BlockSize];
+
+            const int numCoords = static_cast<int>(offsets.cols());
+            intensities.resize(numCoords);
+
+            for (int first = 0; first < numCoords; first += BlockSize) {
+                const int count = std::min<int>(BlockSize, numCoords - first);
+
+                for (int t = 0; t < count; ++t) {
+                    const int i = first + t;
+                    const float ox = offsets(0, i);
+                    const float oy = offsets(1, i);
+                    const int a = anchorIds(i);
+                    coords[2 * t + 0] = linear(0, 0) * ox + linear(0, 1) * oy + anchors(0, a);
+                    coords[2 * t + 1] = linear(1, 0) * ox + linear(1, 1) * oy + anchors(1, a);
+                }
+
+                for (int t = readImageFixedSIMD(img, coords, count, intensities.data() + first); t < count; ++t) {
+                    intensities(first + t) = bilinearSampleFixed(img, coords[2 * t + 0], coords[2 * t + 1]);
+                }
+            }
+        }
+
     }
 }
\ No newline at end of file
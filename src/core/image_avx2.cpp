@@ -0,0 +1,176 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+/*
+    AVX2 image sampling kernels.
+
+    This translation unit is compiled with AVX2 code generation enabled and must only
+    be entered after a runtime CPU check. It works on raw pointers on purpose: instantiating
+    Eigen or standard library templates here could leak AVX2 code into inline functions
+    shared with the rest of the library.
+*/
+
+#include <dest/core/config.h>
+
+#ifdef DEST_WITH_AVX2
+
+#include <immintrin.h>
+
+namespace dest {
+    namespace core {
+        
+        int readImageAVX2(const unsigned char *pixels, int rows, int cols, int outerStride, const float *coords, int numCoords, float *intensities)
+        {
+            // Gathers load 32 bit words. Lanes addressing the last three bytes of the image
+            // load the word ending at the pixel instead, so no lane reads beyond the image.
+            const int lastPixel = (rows - 1) * outerStride + (cols - 1);
+            if (lastPixel < 3)
+                return 0;
+            
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i maxX = _mm256_set1_epi32(cols - 1);
+            const __m256i maxY = _mm256_set1_epi32(rows - 1);
+            const __m256i stride = _mm256_set1_epi32(outerStride);
+            const __m256i lastSafe = _mm256_set1_epi32(lastPixel - 3);
+            const __m256i byteMask = _mm256_set1_epi32(0xFF);
+            const __m256i three = _mm256_set1_epi32(3);
+            const __m256i twentyFour = _mm256_set1_epi32(24);
+            const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            const __m256 onef = _mm256_set1_ps(1.f);
+            const int *base = reinterpret_cast<const int*>(pixels);
+            
+            const int numBlocks = numCoords / 8;
+            for (int b = 0; b < numBlocks; ++b) {
+                // Coordinates are stored interleaved (x0, y0, x1, y1, ...)
+                const __m256 c0 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(coords + b * 16), deinterleave);
+                const __m256 c1 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(coords + b * 16 + 8), deinterleave);
+                const __m256 x = _mm256_permute2f128_ps(c0, c1, 0x20);
+                const __m256 y = _mm256_permute2f128_ps(c0, c1, 0x31);
+                
+                const __m256 fx = _mm256_floor_ps(x);
+                const __m256 fy = _mm256_floor_ps(y);
+                const __m256i ix = _mm256_cvttps_epi32(fx);
+                const __m256i iy = _mm256_cvttps_epi32(fy);
+                
+                const __m256i x0 = _mm256_min_epi32(maxX, _mm256_max_epi32(zero, ix));
+                const __m256i x1 = _mm256_min_epi32(maxX, _mm256_max_epi32(zero, _mm256_add_epi32(ix, one)));
+                const __m256i y0 = _mm256_mullo_epi32(_mm256_min_epi32(maxY, _mm256_max_epi32(zero, iy)), stride);
+                const __m256i y1 = _mm256_mullo_epi32(_mm256_min_epi32(maxY, _mm256_max_epi32(zero, _mm256_add_epi32(iy, one))), stride);
+                
+                __m256i offsets[4] = {
+                    _mm256_add_epi32(y0, x0),
+                    _mm256_add_epi32(y0, x1),
+                    _mm256_add_epi32(y1, x0),
+                    _mm256_add_epi32(y1, x1)
+                };
+                
+                __m256 f[4];
+                for (int k = 0; k < 4; ++k) {
+                    const __m256i atEnd = _mm256_cmpgt_epi32(offsets[k], lastSafe);
+                    const __m256i o = _mm256_sub_epi32(offsets[k], _mm256_and_si256(atEnd, three));
+                    __m256i v = _mm256_i32gather_epi32(base, o, 1);
+                    v = _mm256_and_si256(_mm256_srlv_epi32(v, _mm256_and_si256(atEnd, twentyFour)), byteMask);
+                    f[k] = _mm256_cvtepi32_ps(v);
+                }
+                
+                const __m256 a = _mm256_sub_ps(x, fx);
+                const __m256 bb = _mm256_sub_ps(y, fy);
+                const __m256 ia = _mm256_sub_ps(onef, a);
+                const __m256 ib = _mm256_sub_ps(onef, bb);
+                
+                const __m256 top = _mm256_add_ps(_mm256_mul_ps(f[0], ia), _mm256_mul_ps(f[1], a));
+                const __m256 bottom = _mm256_add_ps(_mm256_mul_ps(f[2], ia), _mm256_mul_ps(f[3], a));
+                const __m256 r = _mm256_add_ps(_mm256_mul_ps(top, ib), _mm256_mul_ps(bottom, bb));
+                
+                _mm256_storeu_ps(intensities + b * 8, r);
+            }
+            
+            return numBlocks * 8;
+        }
+        
+        int readImageFixedAVX2(const unsigned char *pixels, int rows, int cols, int outerStride, const float *coords, int numCoords, int fractionBits, short *intensities)
+        {
+            // Same sampling as readImageAVX2, but interpolates with integer weights
+            // exactly like bilinearSampleFixed.
+            const int lastPixel = (rows - 1) * outerStride + (cols - 1);
+            if (lastPixel < 3)
+                return 0;
+            
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i maxX = _mm256_set1_epi32(cols - 1);
+            const __m256i maxY = _mm256_set1_epi32(rows - 1);
+            const __m256i stride = _mm256_set1_epi32(outerStride);
+            const __m256i lastSafe = _mm256_set1_epi32(lastPixel - 3);
+            const __m256i byteMask = _mm256_set1_epi32(0xFF);
+            const __m256i three = _mm256_set1_epi32(3);
+            const __m256i twentyFour = _mm256_set1_epi32(24);
+            const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            const __m256i unit = _mm256_set1_epi32(1 << fractionBits);
+            const __m256i half = _mm256_set1_epi32((1 << fractionBits) >> 1);
+            const __m256 unitf = _mm256_set1_ps(static_cast<float>(1 << fractionBits));
+            const __m256 halff = _mm256_set1_ps(0.5f);
+            const __m128i shift = _mm_cvtsi32_si128(fractionBits);
+const int *base = reinterpret_cast<const int*>(pixels);
+            
+            const int numBlocks = numCoords / 8;
+            for (int b = 0; b < numBlocks; ++b) {
+                const __m256 c0 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(coords + b * 16), deinterleave);
+                const __m256 c1 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(coords + b * 16 + 8), deinterleave);
+                const __m256 x = _mm256_permute2f128_ps(c0, c1, 0x20);
+                const __m256 y = _mm256_permute2f128_ps(c0, c1, 0x31);
+                
+                const __m256 fx = _mm256_floor_ps(x);
+                const __m256 fy = _mm256_floor_ps(y);
+                const __m256i ix = _mm256_cvttps_epi32(fx);
+                const __m256i iy = _mm256_cvttps_epi32(fy);
+                
+                const __m256i x0 = _mm256_min_epi32(maxX, _mm256_max_epi32(zero, ix));
+                const __m256i x1 = _mm256_min_epi32(maxX, _mm256_max_epi32(zero, _mm256_add_epi32(ix, one)));
+                const __m256i y0 = _mm256_mullo_epi32(_mm256_min_epi32(maxY, _mm256_max_epi32(zero, iy)), stride);
+                const __m256i y1 = _mm256_mullo_epi32(_mm256_min_epi32(maxY, _mm256_max_epi32(zero, _mm256_add_epi32(iy, one))), stride);
+                
+                __m256i offsets[4] = {
+                    _mm256_add_epi32(y0, x0),
+                    _mm256_add_epi32(y0, x1),
+                    _mm256_add_epi32(y1, x0),
+                    _mm256_add_epi32(y1, x1)
+                };
+                
+                __m256i f[4];
+                for (int k = 0; k < 4; ++k) {
+                    const __m256i atEnd = _mm256_cmpgt_epi32(offsets[k], lastSafe);
+                    const __m256i o = _mm256_sub_epi32(offsets[k], _mm256_and_si256(atEnd, three));
+                    const __m256i v = _mm256_i32gather_epi32(base, o, 1);
+                    f[k] = _mm256_and_si256(_mm256_srlv_epi32(v, _mm256_and_si256(atEnd, twentyFour)), byteMask);
+                }
+                
+                const __m256i a = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(x, _mm256_cvtepi32_ps(ix)), unitf), halff));
+                const __m256i bb = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(y, _mm256_cvtepi32_ps(iy)), unitf), halff));
+                const __m256i ia = _mm256_sub_epi32(unit, a);
+                const __m256i ib = _mm256_sub_epi32(unit, bb);
+                
+                const __m256i top = _mm256_add_epi32(_mm256_mullo_epi32(f[0], ia), _mm256_mullo_epi32(f[1], a));
+                const __m256i bottom = _mm256_add_epi32(_mm256_mullo_epi32(f[2], ia), _mm256_mullo_epi32(f[3], a));
+                const __m256i r = _mm256_sra_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(top, ib), _mm256_mullo_epi32(bottom, bb)), half), shift);
+                
+                // Saturating pack keeps lanes in 128 bit halves, gather the low quadwords.
+                const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(r, r), 0x08);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(intensities + b * 8), _mm256_castsi256_si128(packed));
+            }
+            
+            return numBlocks * 8;
+        }
+        
+    }
+}
+
+#endif
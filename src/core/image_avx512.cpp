@@ -0,0 +1,106 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+/*
+    AVX-512 image sampling kernels.
+
+    Same constraints as image_avx2.cpp apply: entered only after a runtime CPU check
+    and restricted to raw pointers.
+*/
+
+#include <dest/core/config.h>
+
+#ifdef DEST_WITH_AVX512
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC 12 headers build undefined source operands from self initialized variables, which
+// -Wmaybe-uninitialized reports once intrinsics are inlined (GCC bug 105593).
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace dest {
+    namespace core {
+        
+        int readImageAVX512(const unsigned char *pixels, int rows, int cols, int outerStride, const float *coords, int numCoords, float *intensities)
+        {
+            // See readImageAVX2 for how lanes close to the end of the image are handled.
+            const int lastPixel = (rows - 1) * outerStride + (cols - 1);
+            if (lastPixel < 3)
+                return 0;
+            
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i one = _mm512_set1_epi32(1);
+            const __m512i maxX = _mm512_set1_epi32(cols - 1);
+            const __m512i maxY = _mm512_set1_epi32(rows - 1);
+            const __m512i stride = _mm512_set1_epi32(outerStride);
+            const __m512i lastSafe = _mm512_set1_epi32(lastPixel - 3);
+            const __m512i byteMask = _mm512_set1_epi32(0xFF);
+            const __m512i three = _mm512_set1_epi32(3);
+            const __m512i twentyFour = _mm512_set1_epi32(24);
+            const __m512i evenIds = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+            const __m512i oddIds = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+            const __m512 onef = _mm512_set1_ps(1.f);
+            const int *base = reinterpret_cast<const int*>(pixels);
+            
+            const int numBlocks = numCoords / 16;
+            for (int b = 0; b < numBlocks; ++b) {
+                // Coordinates are stored interleaved (x0, y0, x1, y1, ...)
+                const __m512 c0 = _mm512_loadu_ps(coords + b * 32);
+                const __m512 c1 = _mm512_loadu_ps(coords + b * 32 + 16);
+                const __m512 x = _mm512_permutex2var_ps(c0, evenIds, c1);
+                const __m512 y = _mm512_permutex2var_ps(c0, oddIds, c1);
+                
+                const __m512 fx = _mm512_roundscale_ps(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+                const __m512 fy = _mm512_roundscale_ps(y, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+                const __m512i ix = _mm512_cvttps_epi32(fx);
+                const __m512i iy = _mm512_cvttps_epi32(fy);
+                
+                const __m512i x0 = _mm512_min_epi32(maxX, _mm512_max_epi32(zero, ix));
+                const __m512i x1 = _mm512_min_epi32(maxX, _mm512_max_epi32(zero, _mm512_add_epi32(ix, one)));
+                const __m512i y0 = _mm512_mullo_epi32(_mm512_min_epi32(maxY, _mm512_max_epi32(zero, iy)), stride);
+                const __m512i y1 = _mm512_mullo_epi32(_mm512_min_epi32(maxY, _mm512_max_epi32(zero, _mm512_add_epi32(iy, one))), stride);
+                
+                __m512i offsets[4] = {
+                    _mm512_add_epi32(y0, x0),
+                    _mm512_add_epi32(y0, x1),
+                    _mm512_add_epi32(y1, x0),
+                    _mm512_add_epi32(y1, x1)
+                };
+                
+                __m512 f[4];
+                for (int k = 0; k < 4; ++k) {
+                    const __mmask16 atEnd = _mm512_cmpgt_epi32_mask(offsets[k], lastSafe);
+                    const __m512i o = _mm512_mask_sub_epi32(offsets[k], atEnd, offsets[k], three);
+                    __m512i v = _mm512_i32gather_epi32(o, base, 1);
+                    v = _mm512_and_si512(_mm512_mask_srlv_epi32(v, atEnd, v, twentyFour), byteMask);
+                    f[k] = _mm512_cvtepi32_ps(v);
+                }
+                
+                const __m512 a = _mm512_sub_ps(x, fx);
+                const __m512 bb = _mm512_sub_ps(y, fy);
+                const __m512 ia = _mm512_sub_ps(onef, a);
+                const __m512 ib = _mm512_sub_ps(onef, bb);
+                
+                const __m512 top = _mm512_add_ps(_mm512_mul_ps(f[0], ia), _mm512_mul_ps(f[1], a));
+                const __m512 bottom = _mm512_add_ps(_mm512_mul_ps(f[2], ia), _mm512_mul_ps(f[3], a));
+                const __m512 r = _mm512_add_ps(_mm512_mul_ps(top, ib), _mm512_mul_ps(bottom, bb));
+                
+                _mm512_storeu_ps(intensities + b * 16, r);
+            }
+            
+            return numBlocks * 16;
+        }
+        
+    }
+}
+
+#endif
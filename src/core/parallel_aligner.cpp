@@ -0,0 +1,185 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+#include <dest/core/parallel_aligner.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+namespace dest {
+    namespace core {
+
+        AlignmentJob::AlignmentJob(const Eigen::Ref<const Image> &img, const std::vector<ShapeTransform> &shapeToImage_)
+        : pixels(img.data()),
+          rows(static_cast<int>(img.rows())),
+          cols(static_cast<int>(img.cols())),
+          outerStride(static_cast<int>(img.outerStride())),
+          shapeToImage(shapeToImage_)
+        {}
+
+        MappedImage AlignmentJob::image() const
+        {
+            return MappedImage(pixels, rows, cols, Eigen::OuterStride<Eigen::Dynamic>(outerStride));
+        }
+
+        struct ParallelAligner::data {
+
+            struct JobQueue {
+                std::mutex mutex;
+                std::deque<int> jobs;
+            };
+
+            const Tracker *tracker;
+            PredictOptions opts;
+            std::vector<std::thread> threads;
+            std::vector<JobQueue> queues;
+
+            std::mutex alignMutex;
+            std::mutex mutex;
+            std::condition_variable wakeWorkers;
+            std::condition_variable batchDone;
+            const std::vector<AlignmentJob> *jobs;
+            std::vector< std::vector<Shape> > *results;
+            unsigned int batch;
+            int numBusy;
+            bool shutdown;
+
+            data(const Tracker &t, int numThreads, const PredictOptions &opts_)
+            : tracker(&t), opts(opts_), queues(numThreads), jobs(0), results(0), batch(0), numBusy(0), shutdown(false)
+            {}
+
+            /**
+                Take next job from own queue or steal one from other workers.
+            */
+            bool nextJob(int worker, int &job) {
+                const int numWorkers = static_cast<int>(queues.size());
+
+                {
+                    JobQueue &q = queues[worker];
+                    std::lock_guard<std::mutex> lock(q.mutex);
+                    if (!q.jobs.empty()) {
+                        job = q.jobs.front();
+                        q.jobs.pop_front();
+                        return true;
+                    }
+                }
+
+                // Steal from the opposite end to keep the victim's locality.
+                for (int i = 1; i < numWorkers; ++i) {
+                    JobQueue &q = queues[(worker + i) % numWorkers];
+                    std::lock_guard<std::mutex> lock(q.mutex);
+                    if (!q.jobs.empty()) {
+                        job = q.jobs.back();
+                        q.jobs.pop_back();
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            void run(int worker) {
+                PredictionContext ctx = tracker->createPredictionContext();
+                unsigned int seenBatch = 0;
+
+                while (true) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        wakeWorkers.wait(lock, [&] { return shutdown || batch != seenBatch; });
+                        if (shutdown)
+                            return;
+                        seenBatch = batch;
+                    }
+
+                    // No jobs are added during a batch, so the batch is done once all queues are empty.
+                    int job;
+                    while (nextJob(worker, job)) {
+                        const AlignmentJob &j = (*jobs)[job];
+                        tracker->predictBatch(j.image(), j.shapeToImage, opts, ctx, (*results)[job]);
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (--numBusy == 0)
+                            batchDone.notify_one();
+                    }
+                }
+            }
+        };
+
+        ParallelAligner::ParallelAligner(const Tracker &t, int numThreads, const PredictOptions &opts)
+        {
+            if (numThreads <= 0) {
+                numThreads = std::max<int>(1, static_cast<int>(std::thread::hardware_concurrency()));
+            }
+
+            _data.reset(new data(t, numThreads, opts));
+            for (int i = 0; i < numThreads; ++i) {
+                _data->threads.push_back(std::thread(&data::run, _data.get(), i));
+            }
+        }
+
+        ParallelAligner::~ParallelAligner()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_data->mutex);
+                _data->shutdown = true;
+            }
+            _data->wakeWorkers.notify_all();
+
+            for (size_t i = 0; i < _data->threads.size(); ++i) {
+                _data->threads[i].join();
+            }
+        }
+
+        void ParallelAligner::align(const std::vector<AlignmentJob> &jobs, std::vector< std::vector<Shape> > &results)
+        {
+            data &d = *_data;
+
+            // Queues and batch state are shared, so one batch is processed at a time.
+            std::lock_guard<std::mutex> serialize(d.alignMutex);
+
+            results.resize(jobs.size());
+            if (jobs.empty())
+                return;
+
+            // Initially assign contiguous ranges of jobs, stealing balances the load later on.
+            const int numJobs = static_cast<int>(jobs.size());
+            const int numWorkers = static_cast<int>(d.queues.size());
+            for (int w = 0; w < numWorkers; ++w) {
+                std::lock_guard<std::mutex> lock(d.queues[w].mutex);
+                const int first = (numJobs * w) / numWorkers;
+                const int last = (numJobs * (w + 1)) / numWorkers;
+                for (int j = first; j < last; ++j) {
+                    d.queues[w].jobs.push_back(j);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(d.mutex);
+                d.jobs = &jobs;
+                d.results = &results;
+                d.numBusy = numWorkers;
+                ++d.batch;
+            }
+            d.wakeWorkers.notify_all();
+
+            std::unique_lock<std::mutex> lock(d.mutex);
+            d.batchDone.wait(lock, [&] { return d.numBusy == 0; });
+        }
+
+        int ParallelAligner::numThreads() const
+        {
+            return static_cast<int>(_data->threads.size());
+        }
+
+    }
+}
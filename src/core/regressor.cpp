@@ -9,10 +9,14 @@
 */
 
 #include <dest/core/regressor.h>
+#include <dest/core/config.h>
 #include <dest/core/tree.h>
+#include <dest/core/forest.h>
 #include <dest/util/log.h>
 #include <dest/io/dest_io_generated.h>
 #include <dest/io/matrix_io.h>
+#include <Eigen/SVD>
+#include <algorithm>
 
 namespace dest {
     namespace core {
@@ -26,10 +30,165 @@ namespace dest {
             Shape meanShape;
             std::vector<Tree> trees;
             float learningRate;
+
+            // Mean shape centered at origin for fast similarity estimation.
+            Shape centeredMeanShape;
+            Eigen::Vector2f meanShapeCenter;
+            float meanShapeSquaredNorm;
+
+            // Packed representation of trees used for prediction.
+            Forest forest;
+            ForestEvaluation evaluation;
+            LeafEncoding leafEncoding;
+
+            // Shape basis leaf residuals are compressed to. Empty if not compressed.
+            Eigen::MatrixXf leafBasis;
+
+            // Encoded leaves used for prediction and saving, one column per leaf in tree order.
+            // Coefficients if compressed. Empty if leaves are neither quantized nor compressed.
+            Eigen::MatrixXf leafValues;
+            float leafScale;
             
             data()
+            : evaluation(ForestEvaluation_TreeWalk), leafEncoding(LeafEncoding_Float32), leafScale(0.f)
             {}
 
+            void centerMeanShape() {
+                meanShapeCenter = meanShape.rowwise().mean();
+                centeredMeanShape = meanShape.colwise() - meanShapeCenter;
+                meanShapeSquaredNorm = centeredMeanShape.squaredNorm();
+            }
+
+            Eigen::AffineCompact2f estimateShapeToShape(const Eigen::Ref<const Shape> &shape) const {
+                return estimateSimilarityTransform(centeredMeanShape, meanShapeCenter, meanShapeSquaredNorm, shape);
+            }
+
+            /**
+                Reorder pixel coordinates to improve locality of image reads.
+
+                Pixel coordinates are drawn in random order. Grouping them by their anchor landmark
+                and sorting each group by offset makes consecutive reads hit nearby image rows.
+                Split tests of all trees are remapped, so predictions do not change.
+            */
+            void sortPixelCoordinates() {
+                const int numCoords = static_cast<int>(shapeRelativePixelCoordinates.cols());
+
+                std::vector<int> order(numCoords);
+                for (int i = 0; i < numCoords; ++i) {
+                    order[i] = i;
+                }
+
+                const PixelCoordinates &offsets = shapeRelativePixelCoordinates;
+                const Eigen::VectorXi &anchorIds = closestShapeLandmark;
+                std::stable_sort(order.begin(), order.end(), [&offsets, &anchorIds](int a, int b) {
+                    if (anchorIds(a) != anchorIds(b)) return anchorIds(a) < anchorIds(b);
+                    if (offsets(1, a) != offsets(1, b)) return offsets(1, a) < offsets(1, b);
+                    return offsets(0, a) < offsets(0, b);
+                });
+
+                bool identity = true;
+                Eigen::VectorXi newIndex(numCoords);
+                PixelCoordinates sortedOffsets(2, numCoords);
+                Eigen::VectorXi sortedAnchorIds(numCoords);
+                for (int i = 0; i < numCoords; ++i) {
+                    newIndex(order[i]) = i;
+                    sortedOffsets.col(i) = offsets.col(order[i]);
+                    sortedAnchorIds(i) = anchorIds(order[i]);
+                    identity = identity && (order[i] == i);
+                }
+
+                if (identity)
+                    return;
+
+                shapeRelativePixelCoordinates.swap(sortedOffsets);
+                closestShapeLandmark.swap(sortedAnchorIds);
+                for (size_t i = 0; i < trees.size(); ++i) {
+                    trees[i].remapPixelIndices(newIndex);
+                }
+            }
+
+            void buildForest() {
+                forest.build(trees, learningRate, evaluation, leafEncoding, &leafBasis,
+                             leafValues.size() > 0 ? &leafValues : 0, leafScale);
+            }
+
+            /**
+                Leaf residuals of all trees, one column per leaf in tree order.
+            */
+            Eigen::MatrixXf collectLeaves() const {
+                std::vector<ShapeResidual> leaves;
+                for (size_t i = 0; i < trees.size(); ++i) {
+                    trees[i].collectLeafMeans(leaves);
+                }
+
+                Eigen::MatrixXf m(leaves.empty() ? 0 : leaves.front().size(), leaves.size());
+                for (size_t i = 0; i < leaves.size(); ++i) {
+                    m.col(i) = Eigen::Map<const Eigen::VectorXf>(leaves[i].data(), leaves[i].size());
+                }
+                return m;
+            }
+
+            /**
+                Make the given leaf values the single representation of leaves.
+
+                Values are quantized to the leaf encoding once. Trees receive the decoded residuals,
+                so that prediction, saving and reloading all see the same leaves.
+
+                \param values Leaf values in tree order, coefficients of the leaf basis if compressed.
+            */
+            void encodeLeaves(Eigen::MatrixXf values) {
+                const bool quantized = (leafEncoding != LeafEncoding_Float32);
+                const bool compressed = (leafBasis.cols() > 0);
+
+                leafScale = quantizeLeaves(values, leafEncoding);
+                if (!quantized && !compressed) {
+                    leafValues.resize(0, 0);
+                    leafScale = 0.f;
+                    return;
+                }
+
+                leafValues.swap(values);
+                updateLeafMeans();
+            }
+
+            /**
+                Encode the leaf residuals of the trees, projected onto the leaf basis if compressed.
+            */
+            void encodeLeafMeans() {
+                if (leafEncoding == LeafEncoding_Float32 && leafBasis.cols() == 0) {
+                    encodeLeaves(Eigen::MatrixXf());
+                    return;
+                }
+
+                const Eigen::MatrixXf m = collectLeaves();
+                encodeLeaves(leafBasis.cols() > 0 ? Eigen::MatrixXf(leafBasis.transpose() * m) : m);
+            }
+
+            /**
+                Replace leaf residuals of trees by the decoded encoded leaves.
+            */
+            void updateLeafMeans() {
+                const Eigen::MatrixXf residuals = (leafBasis.cols() > 0) ? Eigen::MatrixXf(leafBasis * leafValues) : leafValues;
+
+                int first = 0;
+                for (size_t i = 0; i < trees.size(); ++i) {
+                    first = trees[i].setLeafMeans(residuals, first);
+                }
+            }
+
+            /**
+                Append leaf columns of subtree in the order of Tree::collectLeafMeans.
+            */
+            static void collectLeafColumns(const io::Tree &t, int node, std::vector<int> &columns) {
+                const io::TreeNode *n = t.nodes()->Get(node);
+                if (n->idx1() >= 0) {
+                    collectLeafColumns(t, 2 * node + 1, columns);
+                    collectLeafColumns(t, 2 * node + 2, columns);
+                } else {
+                    columns.push_back(n->leaf());
+                }
+            }
+
             flatbuffers::Offset<io::Regressor> save(flatbuffers::FlatBufferBuilder &fbb) const {
                 flatbuffers::Offset<io::MatrixF> lpixels = io::toFbs(fbb, shapeRelativePixelCoordinates);
                 flatbuffers::Offset<io::MatrixI> lcosest = io::toFbs(fbb, closestShapeLandmark);
@@ -37,12 +196,31 @@ namespace dest {
                 flatbuffers::Offset<io::MatrixF> lmeans = io::toFbs(fbb, meanShape);
                 
 
+                // Quantized or compressed leaves are stored in a single matrix referenced by the trees.
+                // Trees enumerate their leaves in the order of the encoded leaf values.
+                const bool quantized = (leafEncoding != LeafEncoding_Float32);
+                const bool compressed = (leafBasis.cols() > 0);
+                std::vector<ShapeResidual> leaves;
+
                 std::vector< flatbuffers::Offset<io::Tree> > ltrees;
                 for (size_t i = 0; i < trees.size(); ++i) {
-                    ltrees.push_back(trees[i].save(fbb));
+                    ltrees.push_back(trees[i].save(fbb, (quantized || compressed) ? &leaves : 0));
                 }
                 auto vtrees = fbb.CreateVector(ltrees);
 
+                flatbuffers::Offset<io::QuantizedMatrix> lleaves;
+                if (quantized) {
+                    lleaves = io::toFbs(fbb, leafValues, leafEncoding == LeafEncoding_Int16 ? io::Int16 : io::Float16, leafScale);
+                }
+
+                flatbuffers::Offset<io::MatrixF> lbasis, lcoeffs;
+                if (compressed) {
+                    lbasis = io::toFbs(fbb, leafBasis);
+                    if (!quantized) {
+                        lcoeffs = io::toFbs(fbb, leafValues);
+                    }
+                }
+
                 io::RegressorBuilder b(fbb);
                 b.add_closestLandmarks(lcosest);
                 b.add_pixelCoordinates(lpixels);
@@ -50,22 +228,69 @@ namespace dest {
                 b.add_meanShape(lmeans);
                 b.add_forest(vtrees);
                 b.add_learningRate(learningRate);
+                if (quantized) {
+                    b.add_quantizedLeaves(lleaves);
+                }
+                if (compressed) {
+                    b.add_leafBasis(lbasis);
+                    if (!quantized) {
+                        b.add_leafCoefficients(lcoeffs);
+                    }
+                }
 
                 return b.Finish();
             }
 
-            void load(const io::Regressor &fbs) {
+            void load(const io::Regressor &fbs, ForestEvaluation e) {
 
                 io::fromFbs(*fbs.closestLandmarks(), closestShapeLandmark);
                 io::fromFbs(*fbs.pixelCoordinates(), shapeRelativePixelCoordinates);
                 io::fromFbs(*fbs.meanShapeResidual(), meanResidual);
                 io::fromFbs(*fbs.meanShape(), meanShape);
+                centerMeanShape();
                 learningRate = fbs.learningRate();
 
+                Eigen::MatrixXf leaves;
+                leafEncoding = LeafEncoding_Float32;
+                leafScale = 0.f;
+                if (fbs.quantizedLeaves()) {
+                    io::fromFbs(*fbs.quantizedLeaves(), leaves);
+                    leafEncoding = (fbs.quantizedLeaves()->type() == io::Int16) ? LeafEncoding_Int16 : LeafEncoding_Float16;
+                    leafScale = fbs.quantizedLeaves()->scale();
+                } else if (fbs.leafCoefficients()) {
+                    io::fromFbs(*fbs.leafCoefficients(), leaves);
+                }
+
+                leafBasis.resize(0, 0);
+                if (fbs.leafBasis()) {
+                    io::fromFbs(*fbs.leafBasis(), leafBasis);
+                }
+
                 trees.resize(fbs.forest()->size());
                 for (flatbuffers::uoffset_t i = 0; i < fbs.forest()->size(); ++i) {
                     trees[i].load(*fbs.forest()->Get(i));
                 }
+
+                // Encoded leaves are used as stored, in the order trees enumerate their leaves.
+                leafValues.resize(0, 0);
+                if (leaves.size() > 0) {
+                    std::vector<int> columns;
+                    for (flatbuffers::uoffset_t i = 0; i < fbs.forest()->size(); ++i) {
+                        if (fbs.forest()->Get(i)->nodes()->size() > 0) {
+                            collectLeafColumns(*fbs.forest()->Get(i), 0, columns);
+                        }
+                    }
+
+                    leafValues.resize(leaves.rows(), columns.size());
+                    for (size_t i = 0; i < columns.size(); ++i) {
+                        leafValues.col(i) = leaves.col(columns[i]);
+                    }
+                    updateLeafMeans();
+                }
+
+                evaluation = e;
+                sortPixelCoordinates();
+                buildForest();
             }
 
 
@@ -93,8 +318,50 @@ namespace dest {
             return _data->save(fbb);
         }
 
-        void Regressor::load(const io::Regressor &fbs) {
-            _data->load(fbs);
+        void Regressor::load(const io::Regressor &fbs, ForestEvaluation evaluation) {
+            _data->load(fbs, evaluation);
+        }
+
+        void Regressor::setLeafEncoding(LeafEncoding encoding) {
+            Regressor::data &data = *_data;
+            const bool compressed = (data.leafBasis.cols() > 0);
+
+            data.leafEncoding = encoding;
+            if (compressed) {
+                // Coefficients of compressed leaves are re-encoded directly to avoid another projection.
+                data.encodeLeaves(data.leafValues);
+            } else {
+                data.encodeLeafMeans();
+            }
+            data.buildForest();
+        }
+
+        LeafEncoding Regressor::leafEncoding() const {
+            return _data->leafEncoding;
+        }
+
+        void Regressor::compressLeaves(int numComponents) {
+            Regressor::data &data = *_data;
+
+            data.leafBasis.resize(0, 0);
+
+            const Eigen::MatrixXf m = data.collectLeaves();
+            numComponents = std::min<int>(numComponents, std::min<int>(static_cast<int>(m.rows()), MaxLeafComponents));
+
+            if (numComponents > 0) {
+                // Principal directions of uncentered leaf residuals minimize the reconstruction error of each leaf.
+                // Left singular vectors of the covariance are its eigenvectors by decreasing eigenvalue.
+                const Eigen::MatrixXf covariance = m * m.transpose();
+                Eigen::JacobiSVD<Eigen::MatrixXf, Eigen::NoQRPreconditioner> svd(covariance, Eigen::ComputeFullU);
+                data.leafBasis = svd.matrixU().leftCols(numComponents);
+            }
+
+            data.encodeLeafMeans();
+            data.buildForest();
+        }
+
+        int Regressor::numLeafComponents() const {
+            return static_cast<int>(_data->leafBasis.cols());
         }
         
         bool Regressor::fit(RegressorTraining &t)
@@ -105,52 +372,77 @@ namespace dest {
             data.learningRate = t.training->params.learningRate;
             data.trees.resize(t.training->params.numTrees);
             data.meanShape = t.meanShape;
+            data.centerMeanShape();
             
             TreeTraining tt;
             tt.numLandmarks = t.numLandmarks;
             tt.training = t.training;
             tt.input = t.input;
-            tt.samples.resize(t.training->samples.size());
-            
+
             // Draw random samples
             tt.pixelCoordinates = sampleCoordinates(t);
             
             // Encode them with respect to the mean shape
             shapeRelativePixelCoordinates(t.meanShape, tt.pixelCoordinates, data.shapeRelativePixelCoordinates, data.closestShapeLandmark);
             
-            // Compute the mean residual, to be used as base learner
-            data.meanResidual = ShapeResidual::Zero(2, t.numLandmarks);
-            for (size_t i = 0; i < tdata.samples.size(); ++i) {
+            // Samples are independent, so residuals and intensities are extracted in parallel.
+            const int numSamples = static_cast<int>(tdata.samples.size());
+            tt.residuals.resize(2 * t.numLandmarks, numSamples);
+            tt.intensities.resize(tt.pixelCoordinates.cols(), numSamples);
+#ifdef DEST_WITH_OPENMP
+            #pragma omp parallel num_threads(numTrainingThreads(tdata.params))
+#endif
+            {
+                PixelCoordinates anchors;
+                PixelIntensities intensities;
+#ifdef DEST_WITH_OPENMP
+                #pragma omp for schedule(static)
+#endif
+                for (int i = 0; i < numSamples; ++i) {
 
-                tt.samples[i].residual = tdata.samples[i].target - tdata.samples[i].estimate;
-                data.meanResidual += tt.samples[i].residual;
-                
-                Eigen::AffineCompact2f tShapeToShape = estimateSimilarityTransform(t.meanShape, tdata.samples[i].estimate);
-                Eigen::AffineCompact2f tShapeToImage = tdata.samples[i].shapeToImage;
-
-                readPixelIntensities(tShapeToShape,
-                                     tShapeToImage,
-                                     tdata.samples[i].estimate,
-                                     t.input->images[tdata.samples[i].inputIdx],
-                                     tt.samples[i].intensities);
-                
+                    const ShapeResidual residual = tdata.samples[i].target - tdata.samples[i].estimate;
+                    tt.residuals.col(i) = Eigen::Map<const Eigen::VectorXf>(residual.data(), residual.size());
+                    
+                    Eigen::AffineCompact2f tShapeToShape = data.estimateShapeToShape(tdata.samples[i].estimate);
+                    Eigen::AffineCompact2f tShapeToImage = tdata.samples[i].shapeToImage;
+
+                    readPixelIntensities(tShapeToShape,
+                                         tShapeToImage,
+                                         tdata.samples[i].estimate,
+                                         t.input->images[tdata.samples[i].inputIdx],
+                                         anchors,
+                                         intensities);
+                    tt.intensities.col(i) = intensities;
+                }
             }
-            data.meanResidual /= static_cast<float>(tdata.samples.size());
+
+            // Compute the mean residual, to be used as base learner. Summed in sample order
+            // to be independent of the number of threads.
+            Eigen::VectorXf meanResidual = Eigen::VectorXf::Zero(2 * t.numLandmarks);
+            for (int i = 0; i < numSamples; ++i) {
+                meanResidual += tt.residuals.col(i);
+            }
+            meanResidual /= static_cast<float>(numSamples);
+            data.meanResidual = Eigen::Map<const ShapeResidual>(meanResidual.data(), 2, t.numLandmarks);
             
             for (int k = 0; k < t.training->params.numTrees; ++k) {
                 DEST_LOG("Building tree " << std::setw(5) << k + 1 << "\r" << std::flush);
-                for (size_t i = 0; i < tdata.samples.size(); ++i) {
-                    
-                    if (k == 0) {
-                        tt.samples[i].residual -= data.meanResidual;
-                    } else {
-                        tt.samples[i].residual -= data.learningRate * data.trees[k - 1].predict(tt.samples[i].intensities);
+                if (k == 0) {
+                    tt.residuals.colwise() -= meanResidual;
+                } else {
+                    const Tree &last = data.trees[k - 1];
+                    for (int i = 0; i < numSamples; ++i) {
+                        const ShapeResidual &leaf = last.nodeMean(last.predictLeaf(tt.intensities.col(i)));
+                        tt.residuals.col(i) -= data.learningRate * Eigen::Map<const Eigen::VectorXf>(leaf.data(), leaf.size());
                     }
                 }
                 data.trees[k].fit(tt);
             }
             
-            
+            data.leafBasis.resize(0, 0);
+            data.sortPixelCoordinates();
+            data.encodeLeafMeans();
+            data.buildForest();
             
             return false;
         }
@@ -175,38 +467,103 @@ namespace dest {
         }
         
         
-        void Regressor::readPixelIntensities(const Eigen::AffineCompact2f &shapeToShape, const Eigen::AffineCompact2f &shapeToImage, const Shape &s, const Image &img, PixelIntensities &intensities) const
+        Eigen::Matrix2f Regressor::transformAnchors(const Eigen::AffineCompact2f &shapeToShape, const Eigen::AffineCompact2f &shapeToImage, const Eigen::Ref<const Shape> &s, PixelCoordinates &anchors) const
         {
-            Regressor::data &data = *_data;
-            
-            PixelCoordinates coords = shapeToShape.matrix().block<2,2>(0,0) * data.shapeRelativePixelCoordinates;
-            
-            const Shape::Index numCoords = data.shapeRelativePixelCoordinates.cols();
-            for(Shape::Index i = 0; i < numCoords; ++i) {
-                coords.col(i) += s.col(data.closestShapeLandmark(i));
+            // Pixel coordinate i is located at shapeToImage * (shapeToShape.linear() * offset_i + s_k), with k being
+            // its closest landmark. Splitting this into a common linear part and per landmark anchors in image space
+            // leaves a single 2x2 transform per pixel coordinate.
+            const Shape::Index numLandmarks = s.cols();
+
+            anchors.resize(2, numLandmarks);
+            for (Shape::Index i = 0; i < numLandmarks; ++i) {
+                anchors.col(i) = shapeToImage * s.col(i);
             }
-            
-            coords = shapeToImage.matrix() * coords.colwise().homogeneous();
 
-            readImage(img, coords, intensities);
+            return shapeToImage.linear() * shapeToShape.linear();
+        }
+
+        void Regressor::readPixelIntensities(const Eigen::AffineCompact2f &shapeToShape, const Eigen::AffineCompact2f &shapeToImage, const Eigen::Ref<const Shape> &s, const Eigen::Ref<const Image> &img, PixelCoordinates &anchors, PixelIntensities &intensities) const
+        {
+            Regressor::data &data = *_data;
+
+            const Eigen::Matrix2f linear = transformAnchors(shapeToShape, shapeToImage, s, anchors);
+            readImage(img, linear, data.shapeRelativePixelCoordinates, data.closestShapeLandmark, anchors, intensities);
+        }
+
+        void Regressor::readPixelIntensities(const Eigen::AffineCompact2f &shapeToShape, const Eigen::AffineCompact2f &shapeToImage, const Eigen::Ref<const Shape> &s, const Eigen::Ref<const Image> &img, PixelCoordinates &anchors, FixedPixelIntensities &intensities) const
+        {
+            Regressor::data &data = *_data;
+
+            const Eigen::Matrix2f linear = transformAnchors(shapeToShape, shapeToImage, s, anchors);
+            readImageFixed(img, linear, data.shapeRelativePixelCoordinates, data.closestShapeLandmark, anchors, intensities);
         }
         
         ShapeResidual Regressor::predict(const Eigen::Ref<const Image> &img, const Shape &shape, const ShapeTransform &shapeToImage) const
+        {
+            PredictionContext ctx;
+            ShapeResidual sr;
+            predict(img, shape, shapeToImage, ctx, sr);
+            return sr;
+        }
+
+        void Regressor::predict(const Eigen::Ref<const Image> &img, const Shape &shape, const ShapeTransform &shapeToImage, PredictionContext &ctx, ShapeResidual &residual, const PredictOptions &opts) const
         {
             Regressor::data &data = *_data;
             
-            PixelIntensities intensities;
-            Eigen::AffineCompact2f shapeToShape = estimateSimilarityTransform(data.meanShape, shape);
-            readPixelIntensities(shapeToShape, shapeToImage, shape, img, intensities);
-            
-            const size_t numTrees = data.trees.size();
-            
-            ShapeResidual sr = data.meanResidual;
-            for(size_t i = 0; i < numTrees; ++i) {
-                sr += data.trees[i].predict(intensities) * data.learningRate;
+            Eigen::AffineCompact2f shapeToShape = data.estimateShapeToShape(shape);
+            residual = data.meanResidual;
+
+            if (data.forest.evaluation() == ForestEvaluation_FixedPoint) {
+                readPixelIntensities(shapeToShape, shapeToImage, shape, img, ctx.anchors, ctx.fixedIntensities);
+                data.forest.predict(ctx.fixedIntensities, residual, opts.maxTreesPerStage);
+            } else {
+                readPixelIntensities(shapeToShape, shapeToImage, shape, img, ctx.anchors, ctx.intensities);
+                data.forest.predict(ctx.intensities, residual, opts.maxTreesPerStage);
             }
-            
-            return sr;
+        }
+
+        void Regressor::predictBatch(const Eigen::Ref<const Image> &img, const Eigen::MatrixXf &shapes, const std::vector<ShapeTransform> &shapeToImage, PredictionContext &ctx, Eigen::MatrixXf &residuals, const PredictOptions &opts) const
+        {
+            Regressor::data &data = *_data;
+
+            const int numShapes = static_cast<int>(shapes.cols());
+            const int numLandmarks = static_cast<int>(data.meanShape.cols());
+            const int numCoords = static_cast<int>(data.shapeRelativePixelCoordinates.cols());
+
+            const bool fixedPoint = (data.forest.evaluation() == ForestEvaluation_FixedPoint);
+
+            if (fixedPoint) {
+                ctx.batchFixedIntensities.resize(numCoords, numShapes);
+            } else {
+                ctx.batchIntensities.resize(numCoords, numShapes);
+            }
+            residuals.resize(2 * numLandmarks, numShapes);
+
+            for (int i = 0; i < numShapes; ++i) {
+                Eigen::Map<const Shape> shape(shapes.col(i).data(), 2, numLandmarks);
+
+                Eigen::AffineCompact2f shapeToShape = data.estimateShapeToShape(shape);
+                if (fixedPoint) {
+                    readPixelIntensities(shapeToShape, shapeToImage[i], shape, img, ctx.anchors, ctx.fixedIntensities);
+                    ctx.batchFixedIntensities.col(i) = ctx.fixedIntensities.transpose();
+                } else {
+                    readPixelIntensities(shapeToShape, shapeToImage[i], shape, img, ctx.anchors, ctx.intensities);
+                    ctx.batchIntensities.col(i) = ctx.intensities.transpose();
+                }
+
+                residuals.col(i) = Eigen::Map<const Eigen::VectorXf>(data.meanResidual.data(), data.meanResidual.size());
+            }
+
+            if (fixedPoint) {
+                data.forest.predict(ctx.batchFixedIntensities, residuals, opts.maxTreesPerStage);
+            } else {
+                data.forest.predict(ctx.batchIntensities, residuals, opts.maxTreesPerStage);
+            }
+        }
+
+        int Regressor::numPixelCoordinates() const
+        {
+            return static_cast<int>(_data->shapeRelativePixelCoordinates.cols());
         }
     }
 }
\ No newline at end of file
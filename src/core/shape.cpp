@@ -14,48 +14,74 @@
 namespace dest {
     namespace core {
         
+        /**
+            Assemble similarity transform from the scaled rotation [a -b; b a] mapping centered
+            source points onto centered target points.
+        */
+        inline Eigen::AffineCompact2f similarityFromCoefficients(float a, float b, const Eigen::Vector2f &meanFrom, const Eigen::Vector2f &meanTo)
+        {
+            Eigen::Matrix<float, 2, 3> ret;
+            ret(0, 0) = a; ret(0, 1) = -b;
+            ret(1, 0) = b; ret(1, 1) = a;
+            ret.col(2) = meanTo - ret.block<2, 2>(0, 0) * meanFrom;
+
+            return Eigen::AffineCompact2f(ret);
+        }
+
         Eigen::AffineCompact2f estimateSimilarityTransform(const Eigen::Ref<const Shape> &from, const Eigen::Ref<const Shape> &to)
-        {            
-            Eigen::Vector2f meanFrom = from.rowwise().mean();
-            Eigen::Vector2f meanTo = to.rowwise().mean();
-            
-            Shape centeredFrom = from.colwise() - meanFrom;
-            Shape centeredTo = to.colwise() - meanTo;
-            
-            Eigen::Matrix2f cov = (centeredFrom) * (centeredTo).transpose();
-            cov /= static_cast<float>(from.cols());
-            const float sFrom = centeredFrom.squaredNorm() / from.cols();
-            
-            auto svd = cov.jacobiSvd(Eigen::ComputeFullU | Eigen::ComputeFullV);
-            Eigen::Matrix2f d = Eigen::Matrix2f::Zero(2, 2);
-            d(0, 0) = svd.singularValues()(0);
-            d(1, 1) = svd.singularValues()(1);
-            
-            // Correct reflection if any.
-            float detCov = cov.determinant();
-            float detUV = svd.matrixU().determinant() * svd.matrixV().determinant();
-            Eigen::Matrix2f s = Eigen::Matrix2f::Identity(2, 2);
-            if (detCov < 0.f || (detCov == 0.f && detUV < 0.f)) {
-                if (svd.singularValues()(1) < svd.singularValues()(0)) {
-                    s(1, 1) = -1;
-                } else {
-                    s(0, 0) = -1;
-                }
+        {
+            // Least squares similarity in closed form. Treating points as complex numbers the
+            // optimal scaled rotation is z = sum(conj(x_i) * y_i) / sum(|x_i|^2) for centered
+            // points x_i, y_i. A 2D similarity never needs a reflection correction.
+            const Eigen::Vector2f meanFrom = from.rowwise().mean();
+            const Eigen::Vector2f meanTo = to.rowwise().mean();
+
+            float dot = 0.f, cross = 0.f, sFrom = 0.f;
+            const Shape::Index numPoints = from.cols();
+            for (Shape::Index i = 0; i < numPoints; ++i) {
+                const float x0 = from(0, i) - meanFrom.x();
+                const float x1 = from(1, i) - meanFrom.y();
+                const float y0 = to(0, i) - meanTo.x();
+                const float y1 = to(1, i) - meanTo.y();
+                dot += x0 * y0 + x1 * y1;
+                cross += x0 * y1 - x1 * y0;
+                sFrom += x0 * x0 + x1 * x1;
             }
-            
-            Eigen::Matrix2f rot = svd.matrixU().transpose() * s * svd.matrixV();
-            float c = 1.f;
-            if (sFrom > 0) {
-                c = 1.f / sFrom * (d * s).trace();
+
+            float a = 1.f, b = 0.f;
+            if (sFrom > 0.f) {
+                a = dot / sFrom;
+                b = cross / sFrom;
             }
-            
-            Eigen::Vector2f t = meanTo - c * rot * meanFrom;
-            
-            Eigen::Matrix<float, 2, 3> ret = Eigen::Matrix<float, 2, 3>::Identity(2, 3);
-            ret.block<2,2>(0,0) = c * rot;
-            ret.block<2,1>(0,2) = t;
-            
-            return Eigen::AffineCompact2f(ret);
+
+            return similarityFromCoefficients(a, b, meanFrom, meanTo);
+        }
+
+        Eigen::AffineCompact2f estimateSimilarityTransform(const Eigen::Ref<const Shape> &centeredFrom, const Eigen::Vector2f &meanFrom, float squaredNormFrom, const Eigen::Ref<const Shape> &to)
+        {
+            // Since the source points sum to zero, the target points do not need to be centered:
+            // sum(x_i * (y_i - m)) = sum(x_i * y_i). A single pass over the target suffices.
+            float dot = 0.f, cross = 0.f;
+            Eigen::Vector2f sumTo = Eigen::Vector2f::Zero();
+            const Shape::Index numPoints = centeredFrom.cols();
+            for (Shape::Index i = 0; i < numPoints; ++i) {
+                const float x0 = centeredFrom(0, i);
+                const float x1 = centeredFrom(1, i);
+                const float y0 = to(0, i);
+                const float y1 = to(1, i);
+                dot += x0 * y0 + x1 * y1;
+                cross += x0 * y1 - x1 * y0;
+                sumTo.x() += y0;
+                sumTo.y() += y1;
+            }
+
+            float a = 1.f, b = 0.f;
+            if (squaredNormFrom > 0.f) {
+                a = dot / squaredNormFrom;
+                b = cross / squaredNormFrom;
+            }
+
+            return similarityFromCoefficients(a, b, meanFrom, sumTo / static_cast<float>(numPoints));
         }
         
         int findClosestLandmarkIndex(const Shape &s, const Eigen::Ref<const Eigen::Vector2f> &x)
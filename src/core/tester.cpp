@@ -9,6 +9,7 @@
 */
 
 #include <dest/core/tester.h>
+#include <dest/core/parallel_aligner.h>
 #include <dest/util/log.h>
 #include <numeric>
 
@@ -55,7 +56,7 @@ namespace dest {
         }
         
 
-        TestResult testTracker(SampleData &td, const Tracker &t, const DistanceNormalizer &norm) {
+        TestResult testTracker(SampleData &td, const Tracker &t, const DistanceNormalizer &norm, int numThreads, const PredictOptions &opts) {
             TestResult r;
             r.meanNormalizedDistance = 0.f;
             r.medianNormalizedDistance = 0.f;
@@ -65,9 +66,20 @@ namespace dest {
             const int nLandmarks = static_cast<int>(td.samples.front().target.cols());
             std::vector<float> d;
             
+            // Align all samples in parallel
+            std::vector<AlignmentJob> jobs;
+            for (size_t i = 0; i < td.samples.size(); ++i) {
+                jobs.push_back(AlignmentJob(td.input->images[td.samples[i].inputIdx], std::vector<ShapeTransform>(1, td.samples[i].shapeToImage)));
+            }
+            
+            DEST_LOG("Aligning " << td.samples.size() << " elements." << std::endl);
+            std::vector< std::vector<Shape> > estimatesInImageSpace;
+            ParallelAligner aligner(t, numThreads, opts);
+            aligner.align(jobs, estimatesInImageSpace);
+            
             for (size_t i = 0; i < td.samples.size(); ++i) {
                 
-                dest::core::Shape estimateInImageSpace = t.predict(td.input->images[td.samples[i].inputIdx], td.samples[i].shapeToImage);
+                const Shape &estimateInImageSpace = estimatesInImageSpace[i].front();
                 td.samples[i].estimate = td.samples[i].shapeToImage.inverse() * estimateInImageSpace.colwise().homogeneous();
                 
                 const float normalizer = norm(td.samples[i]);
@@ -77,9 +89,6 @@ namespace dest {
                         std::cout << i << std::endl;
                     d.push_back(dev(j));
                 }
-            
-                if (i % 100 == 0)
-                    DEST_LOG("Processing " << i << "/" << td.samples.size() << " elements.\r" << std::flush);
             }
             
             std::sort(d.begin(), d.end());
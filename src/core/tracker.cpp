@@ -9,6 +9,7 @@
 */
 
 #include <dest/core/tracker.h>
+#include <dest/core/config.h>
 #include <dest/core/regressor.h>
 #include <dest/util/log.h>
 #include <dest/io/matrix_io.h>
@@ -43,14 +44,14 @@ namespace dest {
                 return b.Finish();
             }
 
-            void load(const io::Tracker &fbs) {
+            void load(const io::Tracker &fbs, ForestEvaluation evaluation) {
 
                 io::fromFbs(*fbs.meanShape(), meanShape);
                 io::fromFbs(*fbs.meanShapeRectCorners(), meanShapeRectCorners);
 
                 cascade.resize(fbs.cascade()->size());
                 for (flatbuffers::uoffset_t i = 0; i < fbs.cascade()->size(); ++i) {
-                    cascade[i].load(*fbs.cascade()->Get(i));
+                    cascade[i].load(*fbs.cascade()->Get(i), evaluation);
                 }
             }
         };
@@ -73,9 +74,23 @@ namespace dest {
             return _data->save(fbb);
         }
 
-        void Tracker::load(const io::Tracker &fbs)
+        void Tracker::load(const io::Tracker &fbs, ForestEvaluation evaluation)
         {
-            _data->load(fbs);
+            _data->load(fbs, evaluation);
+        }
+
+        void Tracker::setLeafEncoding(LeafEncoding encoding)
+        {
+            for (size_t i = 0; i < _data->cascade.size(); ++i) {
+                _data->cascade[i].setLeafEncoding(encoding);
+            }
+        }
+
+        void Tracker::compressLeaves(int numComponents)
+        {
+            for (size_t i = 0; i < _data->cascade.size(); ++i) {
+                _data->cascade[i].compressLeaves(numComponents);
+            }
         }
 
         bool Tracker::save(const std::string &path) const
@@ -90,7 +105,7 @@ namespace dest {
             return !ofs.bad();
         }
 
-        bool Tracker::load(const std::string &path)
+        bool Tracker::load(const std::string &path, ForestEvaluation evaluation)
         {
             std::ifstream ifs(path, std::ifstream::binary);
             if (!ifs.is_open()) return false;
@@ -110,7 +125,7 @@ namespace dest {
             }
 
             const io::Tracker *t = io::GetTracker(buf.data());
-            load(*t);
+            load(*t, evaluation);
 
             return true;
         }
@@ -149,15 +164,31 @@ namespace dest {
                 // Fit gradient boosted trees.
                 data.cascade[i].fit(rt);
                 
-                // Update shape estimate
-                double error = 0.0;
-                for (int s = 0; s < numSamples; ++s) {
-                    t.samples[s].estimate +=
+                // Update shape estimates in parallel. Errors are stored per sample and summed
+                // in sample order, so the result does not depend on the number of threads.
+                std::vector<double> errors(numSamples);
+#ifdef DEST_WITH_OPENMP
+                #pragma omp parallel num_threads(numTrainingThreads(t.params))
+#endif
+                {
+                    PredictionContext ctx;
+#ifdef DEST_WITH_OPENMP
+                    #pragma omp for schedule(static)
+#endif
+                    for (int s = 0; s < numSamples; ++s) {
                         data.cascade[i].predict(t.input->images[t.samples[s].inputIdx],
                                                 t.samples[s].estimate,
-                                                t.samples[s].shapeToImage);
-                    
-                    error += (t.samples[s].target - t.samples[s].estimate).colwise().norm().sum();
+                                                t.samples[s].shapeToImage,
+                                                ctx, ctx.residual);
+                        t.samples[s].estimate += ctx.residual;
+                        
+                        errors[s] = (t.samples[s].target - t.samples[s].estimate).colwise().norm().sum();
+                    }
+                }
+
+                double error = 0.0;
+                for (int s = 0; s < numSamples; ++s) {
+                    error += errors[s];
                 }
                 error /= rt.numLandmarks * numSamples;
                 DEST_LOG("Average error " << std::setprecision(3) << std::fixed << error << std::endl);
@@ -175,25 +206,153 @@ namespace dest {
         }
         
         Shape Tracker::predict(const Eigen::Ref<const Image> &img, const ShapeTransform &shapeToImage, std::vector<Shape> *stepResults) const
+        {
+            PredictionContext ctx;
+            Shape final;
+            predict(img, shapeToImage, ctx, final, stepResults);
+            return final;
+        }
+
+        void Tracker::predict(const Eigen::Ref<const Image> &img, const ShapeTransform &shapeToImage, PredictionContext &ctx, Shape &result, std::vector<Shape> *stepResults) const
+        {
+            predict(img, shapeToImage, PredictOptions(), ctx, result, stepResults);
+        }
+
+        void Tracker::predict(const Eigen::Ref<const Image> &img, const ShapeTransform &shapeToImage, const PredictOptions &opts, PredictionContext &ctx, Shape &result, std::vector<Shape> *stepResults) const
         {
             Tracker::data &data = *_data;
 
-            Shape estimate = data.meanShape;
-            const int numCascades = static_cast<int>(data.cascade.size());
+            Shape &estimate = ctx.estimate;
+            estimate = data.meanShape;
+
+            // Compare squared norms of updates against the squared threshold summed over all landmarks.
+            const float convergedNorm = opts.convergenceThreshold * opts.convergenceThreshold * static_cast<float>(estimate.cols());
+
+            int numCascades = static_cast<int>(data.cascade.size());
+            if (opts.maxStages > 0) {
+                numCascades = std::min<int>(numCascades, opts.maxStages);
+            }
+
+            ctx.numStages = 0;
             for (int i = 0; i < numCascades; ++i) {
                 if (stepResults) {
                     stepResults->push_back(shapeToImage * estimate.colwise().homogeneous());
                 }
-                estimate += data.cascade[i].predict(img, estimate, shapeToImage);
+                data.cascade[i].predict(img, estimate, shapeToImage, ctx, ctx.residual, opts);
+                estimate += ctx.residual;
+                ++ctx.numStages;
+
+                if (ctx.residual.squaredNorm() < convergedNorm) {
+                    break;
+                }
             }
 
-            Shape final = shapeToImage * estimate.colwise().homogeneous();
+            const Shape::Index numLandmarks = estimate.cols();
+            result.resize(2, numLandmarks);
+            for (Shape::Index i = 0; i < numLandmarks; ++i) {
+                result.col(i) = shapeToImage * estimate.col(i);
+            }
 
             if (stepResults) {
-                stepResults->push_back(final);
+                stepResults->push_back(result);
             }
+        }
 
-            return final;
-        }        
+        void Tracker::predictBatch(const Eigen::Ref<const Image> &img, const std::vector<ShapeTransform> &shapeToImage, std::vector<Shape> &results) const
+        {
+            PredictionContext ctx;
+            predictBatch(img, shapeToImage, ctx, results);
+        }
+
+        void Tracker::predictBatch(const Eigen::Ref<const Image> &img, const std::vector<ShapeTransform> &shapeToImage, PredictionContext &ctx, std::vector<Shape> &results) const
+        {
+            predictBatch(img, shapeToImage, PredictOptions(), ctx, results);
+        }
+
+        void Tracker::predictBatch(const Eigen::Ref<const Image> &img, const std::vector<ShapeTransform> &shapeToImage, const PredictOptions &opts, PredictionContext &ctx, std::vector<Shape> &results) const
+        {
+            Tracker::data &data = *_data;
+
+            const int numShapes = static_cast<int>(shapeToImage.size());
+            const int numLandmarks = static_cast<int>(data.meanShape.cols());
+
+            Eigen::MatrixXf &estimates = ctx.batchEstimates;
+            estimates = Eigen::Map<const Eigen::VectorXf>(data.meanShape.data(), data.meanShape.size()).replicate(1, numShapes);
+
+            const float convergedNorm = opts.convergenceThreshold * opts.convergenceThreshold * static_cast<float>(numLandmarks);
+
+            int numCascades = static_cast<int>(data.cascade.size());
+            if (opts.maxStages > 0) {
+                numCascades = std::min<int>(numCascades, opts.maxStages);
+            }
+
+            // Converged shapes are dropped, so that each shape runs the same stages as in predict.
+            std::vector<int> &active = ctx.batchActive;
+            active.resize(numShapes);
+            for (int s = 0; s < numShapes; ++s) {
+                active[s] = s;
+            }
+
+            ctx.numStages = 0;
+            for (int i = 0; i < numCascades && !active.empty(); ++i) {
+                const int numActive = static_cast<int>(active.size());
+
+                if (numActive == numShapes) {
+                    data.cascade[i].predictBatch(img, estimates, shapeToImage, ctx, ctx.batchResiduals, opts);
+                    estimates += ctx.batchResiduals;
+                } else {
+                    ctx.batchActiveEstimates.resize(estimates.rows(), numActive);
+                    ctx.batchActiveTransforms.resize(numActive);
+                    for (int s = 0; s < numActive; ++s) {
+                        ctx.batchActiveEstimates.col(s) = estimates.col(active[s]);
+                        ctx.batchActiveTransforms[s] = shapeToImage[active[s]];
+                    }
+
+                    data.cascade[i].predictBatch(img, ctx.batchActiveEstimates, ctx.batchActiveTransforms, ctx, ctx.batchResiduals, opts);
+                    for (int s = 0; s < numActive; ++s) {
+                        estimates.col(active[s]) += ctx.batchResiduals.col(s);
+                    }
+                }
+                ++ctx.numStages;
+
+                int remaining = 0;
+                for (int s = 0; s < numActive; ++s) {
+                    if (!(ctx.batchResiduals.col(s).squaredNorm() < convergedNorm)) {
+                        active[remaining++] = active[s];
+                    }
+                }
+                active.resize(remaining);
+            }
+
+            results.resize(numShapes);
+            for (int s = 0; s < numShapes; ++s) {
+                Eigen::Map<const Shape> estimate(estimates.col(s).data(), 2, numLandmarks);
+
+                results[s].resize(2, numLandmarks);
+                for (int i = 0; i < numLandmarks; ++i) {
+                    results[s].col(i) = shapeToImage[s] * estimate.col(i);
+                }
+            }
+        }
+
+        PredictionContext Tracker::createPredictionContext() const
+        {
+            Tracker::data &data = *_data;
+
+            int numPixels = 0;
+            for (size_t i = 0; i < data.cascade.size(); ++i) {
+                numPixels = std::max<int>(numPixels, data.cascade[i].numPixelCoordinates());
+            }
+
+            const Shape::Index numLandmarks = data.meanShape.cols();
+
+            PredictionContext ctx;
+            ctx.anchors.resize(2, numLandmarks);
+            ctx.intensities.resize(numPixels);
+            ctx.fixedIntensities.resize(numPixels);
+            ctx.estimate.resize(2, numLandmarks);
+            ctx.residual.resize(2, numLandmarks);
+            return ctx;
+        }
     }
 }
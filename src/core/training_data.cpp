@@ -9,8 +9,12 @@
 */
 
 #include <dest/core/training_data.h>
+#include <dest/core/config.h>
 #include <iomanip>
 #include <dest/util/log.h>
+#ifdef DEST_WITH_OPENMP
+#include <omp.h>
+#endif
 
 namespace dest {
     namespace core {
@@ -26,8 +30,9 @@ namespace dest {
             exponentialLambdaDecreaseFactor = 0.9f;
             learningRate = 0.05f;
             expansionRandomPixelCoordinates = 0.05f;
+            numThreads = 0;
         }
-        
+
         std::ostream& operator<<(std::ostream &stream, const TrainingParameters &obj) {
             stream << std::setw(30) << std::left << "Number of cascades" << std::setw(10) << obj.numCascades << std::endl
                    << std::setw(30) << std::left << "Number of trees" << std::setw(10) << obj.numTrees << std::endl
@@ -37,10 +42,20 @@ namespace dest {
                    << std::setw(30) << std::left << "Random pixel expansion" << std::setw(10) << obj.expansionRandomPixelCoordinates << std::endl
                    << std::setw(30) << std::left << "Exponential lambda" << std::setw(10) << obj.exponentialLambda << std::endl
                    << std::setw(30) << std::left << "Exponential lambda decrease" << std::setw(10) << obj.exponentialLambdaDecreaseFactor << std::endl
-                   << std::setw(30) << std::left << "Learning rate" << std::setw(10) << obj.learningRate;
+                   << std::setw(30) << std::left << "Learning rate" << std::setw(10) << obj.learningRate << std::endl
+                   << std::setw(30) << std::left << "Number of threads" << std::setw(10) << numTrainingThreads(obj);
             return stream;
         }
-        
+
+        int numTrainingThreads(const TrainingParameters &params) {
+#ifdef DEST_WITH_OPENMP
+            return (params.numThreads > 0) ? params.numThreads : omp_get_max_threads();
+#else
+            (void)params;
+            return 1;
+#endif
+        }
+
         SampleCreationParameters::SampleCreationParameters()
         {
             numShapesPerImage = 20;
@@ -12,7 +12,7 @@
 #include <dest/core/config.h>
 #include <dest/util/log.h>
 #include <dest/io/matrix_io.h>
-#include <queue>
+#include <algorithm>
 
 namespace dest {
     namespace core {
@@ -29,20 +29,30 @@ namespace dest {
             // For leaf nodes
             ShapeResidual mean;
             
-            flatbuffers::Offset<io::TreeNode> save(flatbuffers::FlatBufferBuilder &fbb) const {
+            flatbuffers::Offset<io::TreeNode> save(flatbuffers::FlatBufferBuilder &fbb, int leaf) const {
+                if (leaf >= 0) {
+                    return io::CreateTreeNode(fbb, split.idx1, split.idx2, split.threshold, 0, leaf);
+                }
+
                 flatbuffers::Offset<io::MatrixF> lmean = io::toFbs(fbb, mean);
                 return io::CreateTreeNode(fbb, split.idx1, split.idx2, split.threshold, lmean);
             }
             
-            void load(const io::TreeNode &fbs) {
+            void load(const io::TreeNode &fbs, const Eigen::MatrixXf *leaves) {
                 split.idx1 = fbs.idx1();
                 split.idx2 = fbs.idx2();
                 split.threshold = fbs.threshold();
-                io::fromFbs(*fbs.mean(), mean);
+                if (leaves && fbs.leaf() >= 0) {
+                    mean = Eigen::Map<const ShapeResidual>(leaves->col(fbs.leaf()).data(), 2, leaves->rows() / 2);
+                } else if (fbs.mean()) {
+                    io::fromFbs(*fbs.mean(), mean);
+                } else {
+                    mean.resize(2, 0);
+                }
             }
         };
         
-        typedef std::pair<TreeTraining::SampleVector::iterator, TreeTraining::SampleVector::iterator> SampleRange;
+        typedef std::pair<TreeTraining::SampleIdVector::iterator, TreeTraining::SampleIdVector::iterator> SampleRange;
         
         
         struct Tree::NodeInfo {
@@ -71,35 +81,24 @@ namespace dest {
             return static_cast<int>(std::distance(r.first, r.second));
         }
         
-        inline ShapeResidual meanResidualOfRange(const SampleRange &r, int numLandmarks) {
-            ShapeResidual mean = ShapeResidual::Zero(2, numLandmarks);
+        inline ShapeResidual meanResidualOfRange(const TreeTraining &t, const SampleRange &r) {
+            Eigen::VectorXf mean = Eigen::VectorXf::Zero(t.residuals.rows());
+            
+            const float *residuals = t.residuals.data();
+            const Eigen::Index rows = t.residuals.rows();
+            float *m = mean.data();
             
             const int numElements = numElementsInRange(r);
             if (numElements > 0) {
-                for (TreeTraining::SampleVector::iterator i = r.first; i != r.second; ++i) {
-                    mean += i->residual;
-                }
-                mean /= static_cast<float>(numElements);
-            }
-            return mean;
-        }
-        
-        template<class UnaryPredicate>
-        inline std::pair<ShapeResidual, int> meanResidualOfRangeIf(const SampleRange &r, int numLandmarks, UnaryPredicate pred) {
-            ShapeResidual mean = ShapeResidual::Zero(2, numLandmarks);
-            
-            int numElements = 0;
-            for (TreeTraining::SampleVector::iterator i = r.first; i != r.second; ++i) {
-                if (pred(*i)) {
-                    mean += i->residual;
-                    ++numElements;
+                for (TreeTraining::SampleIdVector::iterator i = r.first; i != r.second; ++i) {
+                    const float *res = residuals + static_cast<size_t>(*i) * rows;
+                    for (Eigen::Index j = 0; j < rows; ++j) {
+                        m[j] += res[j];
+                    }
                 }
-            }
-            if (numElements > 0) {
                 mean /= static_cast<float>(numElements);
             }
-            
-            return std::make_pair(mean, numElements);
+            return Eigen::Map<const ShapeResidual>(mean.data(), 2, t.numLandmarks);
         }
         
         struct Tree::data {
@@ -111,24 +110,57 @@ namespace dest {
             : depth(0)
             {}
             
-            flatbuffers::Offset<io::Tree> save(flatbuffers::FlatBufferBuilder &fbb) const {
+            flatbuffers::Offset<io::Tree> save(flatbuffers::FlatBufferBuilder &fbb, std::vector<ShapeResidual> *leaves) const {
                 std::vector<flatbuffers::Offset<io::TreeNode> > nlocs;
                 
-                for (size_t i = 0; i < nodes.size(); ++i) {
-                    nlocs.push_back(nodes[i].save(fbb));
+                // Column of each leaf residual in the shared list.
+                std::vector<int> leafIds(nodes.size(), -1);
+                if (leaves && !nodes.empty()) {
+                    std::vector<int> leafNodes;
+                    collectLeafNodes(0, leafNodes);
+                    for (size_t i = 0; i < leafNodes.size(); ++i) {
+                        leafIds[leafNodes[i]] = static_cast<int>(leaves->size());
+                        leaves->push_back(nodes[leafNodes[i]].mean);
+                    }
                 }
                 
+                for (size_t i = 0; i < nodes.size(); ++i) {
+                    nlocs.push_back(nodes[i].save(fbb, leafIds[i]));
+                }
+
                 return io::CreateTree(fbb, fbb.CreateVector(nlocs), depth);
             }
             
-            void load(const io::Tree &fbs) {
+            void load(const io::Tree &fbs, const Eigen::MatrixXf *leaves) {
                 depth = fbs.depth();
                 
                 nodes.resize(fbs.nodes()->size());
                 for (flatbuffers::uoffset_t i = 0; i < fbs.nodes()->size(); ++i) {
-                    nodes[i].load(*fbs.nodes()->Get(i));
+                    nodes[i].load(*fbs.nodes()->Get(i), leaves);
+                }
+            }
+
+            void collectLeafNodes(int node, std::vector<int> &leafNodes) const {
+                // Nodes below leaves are not initialized, so only reachable nodes are visited.
+                if (nodes[node].split.idx1 < 0) {
+                    leafNodes.push_back(node);
+                } else {
+                    collectLeafNodes(2 * node + 1, leafNodes);
+                    collectLeafNodes(2 * node + 2, leafNodes);
                 }
             }
+
+            void remapPixelIndices(int node, const Eigen::VectorXi &newIndex) {
+                // Nodes below leaves are not initialized, so only reachable nodes are visited.
+                SplitInfo &split = nodes[node].split;
+                if (split.idx1 < 0)
+                    return;
+
+                split.idx1 = newIndex(split.idx1);
+                split.idx2 = newIndex(split.idx2);
+                remapPixelIndices(2 * node + 1, newIndex);
+                remapPixelIndices(2 * node + 2, newIndex);
+            }
         };
         
         
@@ -150,12 +182,12 @@ namespace dest {
 			return *this;
 		}
         
-        flatbuffers::Offset<io::Tree> Tree::save(flatbuffers::FlatBufferBuilder &fbb) const {
-            return _data->save(fbb);
+        flatbuffers::Offset<io::Tree> Tree::save(flatbuffers::FlatBufferBuilder &fbb, std::vector<ShapeResidual> *leaves) const {
+            return _data->save(fbb, leaves);
         }
         
-        void Tree::load(const io::Tree &fbs) {
-            _data->load(fbs);
+        void Tree::load(const io::Tree &fbs, const Eigen::MatrixXf *leaves) {
+            _data->load(fbs, leaves);
         }
         
         bool Tree::fit(TreeTraining &t)
@@ -167,70 +199,142 @@ namespace dest {
             const int numNodes = (int)std::pow(2.0, depth) - 1;
             nodes.resize(numNodes);
 
-            // Split recursively in BFS
-            std::queue<NodeInfo> queue;
-            queue.push(NodeInfo(0, 1, std::make_pair(t.samples.begin(), t.samples.end())));
+            if (t.sampleIds.size() != static_cast<size_t>(t.residuals.cols())) {
+                t.sampleIds.resize(t.residuals.cols());
+                for (size_t i = 0; i < t.sampleIds.size(); ++i) {
+                    t.sampleIds[i] = static_cast<int>(i);
+                }
+            }
+
+            // Split level by level. Nodes of a level cover disjoint sample ranges and are processed concurrently.
+            std::vector<NodeInfo> level(1, NodeInfo(0, 1, std::make_pair(t.sampleIds.begin(), t.sampleIds.end())));
             
-            while (!queue.empty()) {
-                const NodeInfo nr = queue.front(); queue.pop();
+            for (int d = 1; !level.empty(); ++d) {
+                std::vector<NodeInfo> children;
                 
-                if (nr.depth < depth) {
-                    // Generate a split
-                    NodeInfo left, right;
-                    if (splitNode(t, nr, left, right)) {
-                        queue.push(left);
-                        queue.push(right);
-                    } else {
-                        makeLeaf(t, nr);
-                    }
-                    
+                if (d < depth) {
+                    splitLevel(t, level, children);
                 } else {
-                    makeLeaf(t, nr);
+                    const int numNodes = static_cast<int>(level.size());
+#ifdef DEST_WITH_OPENMP
+                    #pragma omp parallel for schedule(dynamic) num_threads(numTrainingThreads(t.training->params))
+#endif
+                    for (int n = 0; n < numNodes; ++n) {
+                        makeLeaf(t, level[n]);
+                    }
                 }
+                
+                level.swap(children);
             }
             
             return true;
         }
         
-        struct Tree::PartitionPredicate {
-            SplitInfo split;
-            
-            bool operator()(const TreeTraining::Sample &s) const {
-                return (s.intensities(split.idx1) - s.intensities(split.idx2)) > split.threshold;
+        void Tree::splitLevel(TreeTraining &t, const std::vector<NodeInfo> &level, std::vector<NodeInfo> &children)
+        {
+            const int numNodes = static_cast<int>(level.size());
+            const int numThreads = numTrainingThreads(t.training->params);
+            
+            // Generate random split positions. Done serially in node order, as all nodes draw from the same random engine.
+            std::vector< std::vector<SplitInfo> > splits(numNodes);
+            for (int n = 0; n < numNodes; ++n) {
+                if (level[n].range.first != level[n].range.second) {
+                    sampleSplitPositions(t, splits[n]);
+                }
             }
             
-        };
-        
-        bool Tree::splitNode(TreeTraining &t, const NodeInfo &parent, NodeInfo &left, NodeInfo &right) {
-            
-            const bool emptyRange = parent.range.second == parent.range.first;
-            if (emptyRange) {
-                // Premature leaf
-                return false;
+            // Candidates of each node are evaluated in contiguous blocks, one pass over the node's samples
+            // per block. Small levels get multiple blocks per node to keep all threads busy.
+            struct SplitTask {
+                int node;
+                int first;
+                int last;
+            };
+            
+            const int blocksPerNode = (numThreads + numNodes - 1) / numNodes;
+            std::vector<SplitTask> tasks;
+            std::vector< std::vector<float> > energies(numNodes);
+            for (int n = 0; n < numNodes; ++n) {
+                const int numSplits = static_cast<int>(splits[n].size());
+                const int numBlocks = std::min(blocksPerNode, numSplits);
+                for (int b = 0; b < numBlocks; ++b) {
+                    SplitTask task;
+                    task.node = n;
+                    task.first = (numSplits * b) / numBlocks;
+                    task.last = (numSplits * (b + 1)) / numBlocks;
+                    tasks.push_back(task);
+                }
+                energies[n].resize(numSplits);
             }
             
-            // Generate random split positions
-            std::vector<SplitInfo> splits;
-            sampleSplitPositions(t, splits);
-
-            if (splits.empty())
-                return false;
-            
-            const ShapeResidual meanResidualParent = meanResidualOfRange(parent.range, t.numLandmarks);
-
-            const int numSplits = static_cast<int>(splits.size());
-            std::vector<float> energies(splits.size());
+            std::vector<ShapeResidual> meanResiduals(numNodes);
+#ifdef DEST_WITH_OPENMP
+            #pragma omp parallel num_threads(numThreads)
+#endif
+            {
+#ifdef DEST_WITH_OPENMP
+                #pragma omp for schedule(dynamic)
+#endif
+                for (int n = 0; n < numNodes; ++n) {
+                    if (!splits[n].empty()) {
+                        meanResiduals[n] = meanResidualOfRange(t, level[n].range);
+                    }
+                }
+                
+                const int numTasks = static_cast<int>(tasks.size());
+#ifdef DEST_WITH_OPENMP
+                #pragma omp for schedule(dynamic)
+#endif
+                for (int i = 0; i < numTasks; ++i) {
+                    const SplitTask &task = tasks[i];
+                    splitEnergies(t, level[task.node], meanResiduals[task.node],
+                                  &splits[task.node][task.first], task.last - task.first,
+                                  &energies[task.node][task.first]);
+                }
+            }
             
+            // Partition samples of each node, or turn nodes without valid split into leaves.
+            std::vector<NodeInfo> childNodes(2 * numNodes);
+            std::vector<char> isSplit(numNodes);
 #ifdef DEST_WITH_OPENMP
-            #pragma omp parallel for schedule(static)
+            #pragma omp parallel for schedule(dynamic) num_threads(numThreads)
 #endif
-            for (int i = 0; i < numSplits; ++i) {
-                energies[i] = splitEnergy(t, parent, meanResidualParent, splits[i]);
+            for (int n = 0; n < numNodes; ++n) {
+                isSplit[n] = splitNode(t, level[n], splits[n], energies[n], childNodes[2 * n], childNodes[2 * n + 1]);
+                if (!isSplit[n]) {
+                    makeLeaf(t, level[n]);
+                }
+            }
+            
+            children.clear();
+            for (int n = 0; n < numNodes; ++n) {
+                if (isSplit[n]) {
+                    children.push_back(childNodes[2 * n]);
+                    children.push_back(childNodes[2 * n + 1]);
+                }
             }
+        }
 
+        struct Tree::PartitionPredicate {
+            SplitInfo split;
+            const float *intensities;
+            Eigen::Index numIntensities;
+
+            bool operator()(int sample) const {
+                const float *s = intensities + static_cast<size_t>(sample) * numIntensities;
+                return (s[split.idx1] - s[split.idx2]) > split.threshold;
+            }
+            
+        };
+        
+        bool Tree::splitNode(TreeTraining &t, const NodeInfo &parent, const std::vector<SplitInfo> &splits, const std::vector<float> &energies, NodeInfo &left, NodeInfo &right) {
+            
+            // Premature leaf on empty range or without valid split candidates
+            if (splits.empty())
+                return false;
 
             // Choose best split according to minimization of residual energy
-            std::vector<float>::iterator maxIter = std::max_element(energies.begin(), energies.end());
+            std::vector<float>::const_iterator maxIter = std::max_element(energies.begin(), energies.end());
             int bestSplit = static_cast<int>(std::distance(energies.begin(), maxIter));
             
             TreeNode &parentNode = _data->nodes[parent.node];
@@ -238,7 +342,9 @@ namespace dest {
             
             PartitionPredicate pred;
             pred.split = splits[bestSplit];
-            TreeTraining::SampleVector::iterator middle = std::partition(parent.range.first, parent.range.second, pred);
+            pred.intensities = t.intensities.data();
+            pred.numIntensities = t.intensities.rows();
+            TreeTraining::SampleIdVector::iterator middle = std::partition(parent.range.first, parent.range.second, pred);
             
             if (middle == parent.range.first || middle == parent.range.second) {
                 return false;
@@ -259,7 +365,7 @@ namespace dest {
             Tree::TreeNode &leaf = _data->nodes[ni.node];
             leaf.split.idx1 = -1;
             leaf.split.idx2 = -1;
-            leaf.mean = meanResidualOfRange(ni.range, t.numLandmarks);
+            leaf.mean = meanResidualOfRange(t, ni.range);
         }
         
         void Tree::sampleSplitPositions(TreeTraining &t, std::vector<SplitInfo> &splits) const
@@ -299,24 +405,61 @@ namespace dest {
             }
         }
         
-        float Tree::splitEnergy(TreeTraining &t, const NodeInfo &parent, const ShapeResidual &parentMeanResidual, const SplitInfo &split) const {
+        void Tree::splitEnergies(const TreeTraining &t, const NodeInfo &parent, const ShapeResidual &parentMeanResidual, const SplitInfo *splits, int numSplits, float *energies) const {
             
-            PartitionPredicate pred;
-            pred.split = split;
+            const float *residuals = t.residuals.data();
+            const Eigen::Index rows = t.residuals.rows();
+            const float *intensities = t.intensities.data();
+            const Eigen::Index numIntensities = t.intensities.rows();
             
-            std::pair<ShapeResidual, int> left = meanResidualOfRangeIf(parent.range, t.numLandmarks, pred);
+            // Residual sums of samples going left, one column per candidate.
+            Eigen::MatrixXf sums = Eigen::MatrixXf::Zero(rows, numSplits);
+            std::vector<int> counts(numSplits, 0);
             
-            const float numLeft = static_cast<float>(left.second);
-            const float numParent = static_cast<float>(numElementsInRange(parent.range));
-            const float numRight = numParent - numLeft;
+            for (TreeTraining::SampleIdVector::iterator i = parent.range.first; i != parent.range.second; ++i) {
+                const float *s = intensities + static_cast<size_t>(*i) * numIntensities;
+                const float *res = residuals + static_cast<size_t>(*i) * rows;
+                
+                for (int k = 0; k < numSplits; ++k) {
+                    if ((s[splits[k].idx1] - s[splits[k].idx2]) > splits[k].threshold) {
+                        float *sum = sums.col(k).data();
+                        for (Eigen::Index j = 0; j < rows; ++j) {
+                            sum[j] += res[j];
+                        }
+                        ++counts[k];
+                    }
+                }
+            }
             
-            ShapeResidual rRight = (numParent * parentMeanResidual - numLeft * left.first) / numRight;
+            const float numParent = static_cast<float>(numElementsInRange(parent.range));
             
-            return left.second * left.first.squaredNorm() + numRight * rRight.squaredNorm();
+            for (int k = 0; k < numSplits; ++k) {
+                ShapeResidual rLeft = Eigen::Map<const ShapeResidual>(sums.col(k).data(), 2, t.numLandmarks);
+                if (counts[k] > 0) {
+                    rLeft /= static_cast<float>(counts[k]);
+                }
+                
+                const float numLeft = static_cast<float>(counts[k]);
+                const float numRight = numParent - numLeft;
+                
+                ShapeResidual rRight = (numParent * parentMeanResidual - numLeft * rLeft) / numRight;
+                
+                energies[k] = counts[k] * rLeft.squaredNorm() + numRight * rRight.squaredNorm();
+            }
         }
 
         
         ShapeResidual Tree::predict(const PixelIntensities &intensities) const
+        {
+            return _data->nodes[predictLeaf(intensities)].mean;
+        }
+
+        void Tree::predict(const PixelIntensities &intensities, ShapeResidual &residual, float scale) const
+        {
+            residual += scale * _data->nodes[predictLeaf(intensities)].mean;
+        }
+
+        int Tree::predictLeaf(const Eigen::Ref<const PixelIntensities> &intensities) const
         {
             const TreeNode *nodes = &_data->nodes[0];
             
@@ -334,7 +477,61 @@ namespace dest {
                 n = left ? 2 * n + 1 : 2 * n + 2;
             }
             
-            return nodes[n].mean;
+            return n;
+        }
+
+        int Tree::depth() const
+        {
+            return _data->depth;
+        }
+
+        bool Tree::nodeSplit(int node, int &idx1, int &idx2, float &threshold) const
+        {
+            const TreeNode &n = _data->nodes[node];
+            if (n.split.idx1 < 0)
+                return false;
+
+            idx1 = n.split.idx1;
+            idx2 = n.split.idx2;
+            threshold = n.split.threshold;
+            return true;
+        }
+
+        const ShapeResidual &Tree::nodeMean(int node) const
+        {
+            return _data->nodes[node].mean;
+        }
+
+        void Tree::collectLeafMeans(std::vector<ShapeResidual> &leaves) const
+        {
+            if (_data->nodes.empty())
+                return;
+
+            std::vector<int> leafNodes;
+            _data->collectLeafNodes(0, leafNodes);
+            for (size_t i = 0; i < leafNodes.size(); ++i) {
+                leaves.push_back(_data->nodes[leafNodes[i]].mean);
+            }
+        }
+
+        int Tree::setLeafMeans(const Eigen::MatrixXf &leaves, int first)
+        {
+            if (_data->nodes.empty())
+                return first;
+
+            std::vector<int> leafNodes;
+            _data->collectLeafNodes(0, leafNodes);
+            for (size_t i = 0; i < leafNodes.size(); ++i, ++first) {
+                _data->nodes[leafNodes[i]].mean = Eigen::Map<const ShapeResidual>(leaves.col(first).data(), 2, leaves.rows() / 2);
+            }
+            return first;
+        }
+
+        void Tree::remapPixelIndices(const Eigen::VectorXi &newIndex)
+        {
+            if (!_data->nodes.empty()) {
+                _data->remapPixelIndices(0, newIndex);
+            }
         }
 
         
@@ -0,0 +1,104 @@
+/**
+    This file is part of Deformable Shape Tracking (DEST).
+
+    Copyright(C) 2015/2016 Christoph Heindl
+    All rights reserved.
+
+    This software may be modified and distributed under the terms
+    of the BSD license.See the LICENSE file for details.
+*/
+
+#include <dest/util/cpu.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #define DEST_CPU_X86
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #include <cpuid.h>
+    #define DEST_CPU_X86
+#endif
+
+namespace dest {
+    namespace util {
+
+#ifdef DEST_CPU_X86
+        
+        inline void cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+            int r[4];
+            __cpuidex(r, leaf, subleaf);
+            for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned int>(r[i]);
+#else
+            __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        }
+        
+        inline unsigned long long xgetbv(unsigned int index) {
+#if defined(_MSC_VER)
+            return _xgetbv(index);
+#else
+            unsigned int eax, edx;
+            __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+            return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+        }
+        
+        inline SimdLevel detectSimdLevel() {
+            unsigned int regs[4];
+            
+            cpuid(0, 0, regs);
+            const unsigned int maxLeaf = regs[0];
+            if (maxLeaf < 1)
+                return SimdLevel_None;
+            
+            cpuid(1, 0, regs);
+            if ((regs[3] & (1u << 26)) == 0)
+                return SimdLevel_None;
+            
+            // OSXSAVE and AVX
+            const unsigned int osxsaveAndAVX = (1u << 27) | (1u << 28);
+            if (maxLeaf < 7 || (regs[2] & osxsaveAndAVX) != osxsaveAndAVX)
+                return SimdLevel_SSE2;
+            
+            // Operating system saves XMM and YMM state
+            const unsigned long long xcr0 = xgetbv(0);
+            if ((xcr0 & 0x6) != 0x6)
+                return SimdLevel_SSE2;
+            
+            cpuid(7, 0, regs);
+            if ((regs[1] & (1u << 5)) == 0)
+                return SimdLevel_SSE2;
+            
+            // AVX512F and operating system saves opmask and ZMM state
+            if ((regs[1] & (1u << 16)) == 0 || (xcr0 & 0xE0) != 0xE0)
+                return SimdLevel_AVX2;
+            
+            return SimdLevel_AVX512;
+        }
+
+#else
+
+        inline SimdLevel detectSimdLevel() {
+            return SimdLevel_None;
+        }
+
+#endif
+
+        static SimdLevel maxSimdLevel = SimdLevel_AVX512;
+
+        SimdLevel cpuSimdLevel() {
+            static const SimdLevel level = detectSimdLevel();
+            return level;
+        }
+        
+        SimdLevel simdLevel() {
+            const SimdLevel level = cpuSimdLevel();
+            return (level < maxSimdLevel) ? level : maxSimdLevel;
+        }
+        
+        void setMaxSimdLevel(SimdLevel level) {
+            maxSimdLevel = level;
+        }
+
+    }
+}
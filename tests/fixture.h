@@ -0,0 +1,86 @@
+/**
+This file is part of Deformable Shape Tracking (DEST).
+
+Copyright(C) 2015/2016 Christoph Heindl
+All rights reserved.
+
+This software may be modified and distributed under the terms
+of the BSD license.See the LICENSE file for details.
+*/
+
+#ifndef DEST_TESTS_FIXTURE_H
+#define DEST_TESTS_FIXTURE_H
+
+#include <dest/core/tracker.h>
+#include <dest/core/training_data.h>
+#include <cmath>
+#include <random>
+
+/*
+    Synthetic data and tracker shared by the tests and by the code generation fixture.
+*/
+namespace fixture {
+
+    /* Create images showing a bright blob at each landmark of a randomly placed circle shape. */
+    inline void createInputData(dest::core::InputData &input, int numImages, unsigned int seed) {
+        std::mt19937 rnd(seed);
+        std::uniform_real_distribution<float> d(-1.f, 1.f);
+
+        const int numLandmarks = 8;
+        dest::core::Shape base(2, numLandmarks);
+        for (int i = 0; i < numLandmarks; ++i) {
+            const float a = 6.2831853f * i / numLandmarks;
+            base(0, i) = 0.35f * std::cos(a);
+            base(1, i) = 0.3f * std::sin(a);
+        }
+
+        for (int k = 0; k < numImages; ++k) {
+            dest::core::Image img(80, 90);
+            for (int y = 0; y < img.rows(); ++y) {
+                for (int x = 0; x < img.cols(); ++x) {
+                    img(y, x) = static_cast<unsigned char>((x + y + rnd() % 32) & 0x7F);
+                }
+            }
+
+            const float s = 40.f + 5.f * d(rnd);
+            const float tx = 45.f + 5.f * d(rnd);
+            const float ty = 40.f + 5.f * d(rnd);
+
+            dest::core::ShapeTransform t;
+            t = Eigen::Translation2f(tx, ty) * Eigen::Rotation2Df(0.2f * d(rnd)) * Eigen::Scaling(s);
+            dest::core::Shape shape = t * (base + 0.03f * dest::core::Shape::Random(2, numLandmarks)).colwise().homogeneous();
+
+            for (int i = 0; i < numLandmarks; ++i) {
+                const int cx = static_cast<int>(shape(0, i));
+                const int cy = static_cast<int>(shape(1, i));
+                img.block(cy - 1, cx - 1, 3, 3).setConstant(255);
+            }
+
+            input.images.push_back(img);
+            input.shapes.push_back(shape);
+            input.rects.push_back(dest::core::createRectangle(Eigen::Vector2f(tx - s * 0.5f, ty - s * 0.5f), Eigen::Vector2f(tx + s * 0.5f, ty + s * 0.5f)));
+        }
+
+        dest::core::InputData::normalizeShapes(input);
+    }
+
+    inline void trainTracker(dest::core::Tracker &t, int numThreads) {
+        dest::core::InputData input;
+        createInputData(input, 20, 1);
+
+        dest::core::SampleData td(input);
+        td.params.numCascades = 3;
+        td.params.numTrees = 20;
+        td.params.maxTreeDepth = 4;
+        td.params.numRandomPixelCoordinates = 50;
+        td.params.numThreads = numThreads;
+
+        dest::core::SampleCreationParameters sp;
+        sp.numShapesPerImage = 4;
+        dest::core::SampleData::createTrainingSamples(td, sp);
+
+        t.fit(td);
+    }
+}
+
+#endif
@@ -0,0 +1,46 @@
+/**
+This file is part of Deformable Shape Tracking (DEST).
+
+Copyright(C) 2015/2016 Christoph Heindl
+All rights reserved.
+
+This software may be modified and distributed under the terms
+of the BSD license.See the LICENSE file for details.
+*/
+
+#include "fixture.h"
+
+#include <iostream>
+#include <string>
+
+/*
+    Train the fixture tracker and save it with float32 leaves and with compressed int16 leaves.
+    Used at build time to generate the code tested in test_codegen.cpp.
+*/
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " output-directory" << std::endl;
+        return -1;
+    }
+
+    const std::string dir(argv[1]);
+
+    dest::core::Tracker t;
+    fixture::trainTracker(t, 0);
+
+    if (!t.save(dir + "/fixture_float32.bin")) {
+        std::cerr << "Failed to save tracker." << std::endl;
+        return -1;
+    }
+
+    t.compressLeaves(6);
+    t.setLeafEncoding(dest::core::LeafEncoding_Int16);
+
+    if (!t.save(dir + "/fixture_int16.bin")) {
+        std::cerr << "Failed to save tracker." << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+/**
+This file is part of Deformable Shape Tracking (DEST).
+
+Copyright(C) 2015/2016 Christoph Heindl
+All rights reserved.
+
+This software may be modified and distributed under the terms
+of the BSD license.See the LICENSE file for details.
+*/
+
+#include "catch.hpp"
+#include "fixture.h"
+
+#include <fixture_float32.h>
+#include <fixture_int16.h>
+
+/*
+    Generated sources are created at build time by dest_codegen from trackers saved by make_fixture.cpp.
+*/
+
+TEST_CASE("codegen-float32")
+{
+    dest::core::Tracker t;
+    REQUIRE(t.load(DEST_FIXTURE_DIR "/fixture_float32.bin"));
+    REQUIRE(fixture_float32::NumLandmarks == 8);
+
+    dest::core::InputData input;
+    fixture::createInputData(input, 10, 19);
+
+    for (size_t i = 0; i < input.images.size(); ++i) {
+        dest::core::Shape expected = t.predict(input.images[i], input.shapeToImage[i]);
+        dest::core::Shape s = fixture_float32::predict(input.images[i], input.shapeToImage[i]);
+        REQUIRE(s == expected);
+    }
+}
+
+TEST_CASE("codegen-compressed-int16")
+{
+    dest::core::Tracker t;
+    REQUIRE(t.load(DEST_FIXTURE_DIR "/fixture_int16.bin"));
+
+    dest::core::InputData input;
+    fixture::createInputData(input, 10, 23);
+
+    for (size_t i = 0; i < input.images.size(); ++i) {
+        dest::core::Shape expected = t.predict(input.images[i], input.shapeToImage[i]);
+        dest::core::Shape s = fixture_int16::predict(input.images[i], input.shapeToImage[i]);
+
+        // Generated code expands each leaf to float, the tracker expands summed coefficients.
+        REQUIRE((s - expected).cwiseAbs().maxCoeff() < 1e-3f);
+    }
+}
@@ -0,0 +1,406 @@
+/**
+This file is part of Deformable Shape Tracking (DEST).
+
+Copyright(C) 2015/2016 Christoph Heindl
+All rights reserved.
+
+This software may be modified and distributed under the terms
+of the BSD license.See the LICENSE file for details.
+*/
+
+#include "catch.hpp"
+
+#include <dest/core/forest.h>
+#include <dest/io/matrix_io.h>
+#include <dest/util/cpu.h>
+#include <Eigen/SVD>
+
+namespace {
+
+    /* Create a tree of depth 3 whose right child of the root is a premature leaf. */
+    dest::core::Tree createTree(int seed) {
+        flatbuffers::FlatBufferBuilder fbb;
+        std::vector< flatbuffers::Offset<dest::io::TreeNode> > nodes;
+
+        dest::core::ShapeResidual empty;
+        for (int i = 0; i < 7; ++i) {
+            dest::core::ShapeResidual mean = dest::core::ShapeResidual::Constant(2, 3, static_cast<float>(seed * 10 + i));
+            bool leaf = (i >= 2);
+            auto lmean = dest::io::toFbs(fbb, leaf ? mean : empty);
+            nodes.push_back(dest::io::CreateTreeNode(fbb, leaf ? -1 : i, leaf ? -1 : i + 1, leaf ? 0.f : 10.f * (seed - 1), lmean));
+        }
+
+        auto tree = dest::io::CreateTree(fbb, fbb.CreateVector(nodes), 3);
+        fbb.Finish(tree);
+
+        dest::core::Tree t;
+        t.load(*flatbuffers::GetRoot<dest::io::Tree>(fbb.GetBufferPointer()));
+        return t;
+    }
+
+    /* Create a full tree of given depth with random split tests on 8 pixels. */
+    dest::core::Tree createFullTree(int depth, int numLandmarks = 3) {
+        flatbuffers::FlatBufferBuilder fbb;
+        std::vector< flatbuffers::Offset<dest::io::TreeNode> > nodes;
+
+        const int numSplits = (1 << (depth - 1)) - 1;
+        const int numNodes = (1 << depth) - 1;
+
+        dest::core::ShapeResidual empty;
+        for (int i = 0; i < numNodes; ++i) {
+            bool leaf = (i >= numSplits);
+            auto lmean = dest::io::toFbs(fbb, leaf ? dest::core::ShapeResidual(dest::core::ShapeResidual::Random(2, numLandmarks)) : empty);
+            nodes.push_back(dest::io::CreateTreeNode(fbb, leaf ? -1 : rand() % 8, leaf ? -1 : rand() % 8, leaf ? 0.f : 32.f * (rand() % 5 - 2), lmean));
+        }
+
+        auto tree = dest::io::CreateTree(fbb, fbb.CreateVector(nodes), depth);
+        fbb.Finish(tree);
+
+        dest::core::Tree t;
+        t.load(*flatbuffers::GetRoot<dest::io::Tree>(fbb.GetBufferPointer()));
+        return t;
+    }
+}
+
+TEST_CASE("forest-matches-trees")
+{
+    std::vector<dest::core::Tree> trees;
+    trees.push_back(createTree(0));
+    trees.push_back(createTree(1));
+    trees.push_back(createTree(2));
+
+    dest::core::Forest f;
+    f.build(trees, 0.5f);
+
+    REQUIRE(f.numTrees() == 3);
+    REQUIRE(f.depth() == 3);
+
+    for (int k = 0; k < 20; ++k) {
+        dest::core::PixelIntensities intensities = dest::core::PixelIntensities::Random(4) * 64.f;
+
+        dest::core::ShapeResidual expected = dest::core::ShapeResidual::Zero(2, 3);
+        dest::core::ShapeResidual accumulated = dest::core::ShapeResidual::Zero(2, 3);
+        for (size_t i = 0; i < trees.size(); ++i) {
+            expected += trees[i].predict(intensities) * 0.5f;
+            trees[i].predict(intensities, accumulated, 0.5f);
+            REQUIRE(trees[i].nodeMean(trees[i].predictLeaf(intensities)) == trees[i].predict(intensities));
+        }
+        REQUIRE(accumulated == expected);
+
+        dest::core::ShapeResidual r = dest::core::ShapeResidual::Zero(2, 3);
+        f.predict(intensities, r);
+
+        REQUIRE(r == expected);
+
+        dest::core::Forest fb;
+        fb.build(trees, 0.5f, dest::core::ForestEvaluation_BitVector);
+        dest::core::ShapeResidual rb = dest::core::ShapeResidual::Zero(2, 3);
+        fb.predict(intensities, rb);
+
+        REQUIRE(rb == expected);
+
+        Eigen::MatrixXf batchIntensities(4, 2);
+        batchIntensities.col(0) = intensities.transpose();
+        batchIntensities.col(1) = intensities.transpose();
+        Eigen::MatrixXf batchResiduals = Eigen::MatrixXf::Zero(6, 2);
+        f.predict(batchIntensities, batchResiduals);
+
+        REQUIRE(batchResiduals.col(0) == Eigen::Map<Eigen::VectorXf>(expected.data(), 6));
+        REQUIRE(batchResiduals.col(1) == Eigen::Map<Eigen::VectorXf>(expected.data(), 6));
+    }
+}
+
+TEST_CASE("forest-depths")
+{
+    // Covers unrolled, generic and bitvector evaluation.
+    for (int depth = 1; depth <= 8; ++depth) {
+        const int numTrees = (depth == 5) ? 300 : 5;
+
+        std::vector<dest::core::Tree> trees;
+        for (int i = 0; i < numTrees; ++i) {
+            trees.push_back(createFullTree(depth));
+        }
+
+        dest::core::Forest f, fb;
+        f.build(trees, 0.25f);
+        fb.build(trees, 0.25f, dest::core::ForestEvaluation_BitVector);
+        REQUIRE(f.depth() == depth);
+        REQUIRE(f.evaluation() == dest::core::ForestEvaluation_TreeWalk);
+        REQUIRE(fb.evaluation() == (depth <= 7 ? dest::core::ForestEvaluation_BitVector : dest::core::ForestEvaluation_TreeWalk));
+
+        Eigen::MatrixXf batchIntensities = Eigen::MatrixXf::Random(8, 20) * 64.f;
+        Eigen::MatrixXf batchResiduals = Eigen::MatrixXf::Zero(6, 20);
+        fb.predict(batchIntensities, batchResiduals);
+
+        for (int k = 0; k < 20; ++k) {
+            dest::core::PixelIntensities intensities = batchIntensities.col(k).transpose();
+
+            dest::core::ShapeResidual expected = dest::core::ShapeResidual::Zero(2, 3);
+            for (size_t i = 0; i < trees.size(); ++i) {
+                trees[i].predict(intensities, expected, 0.25f);
+            }
+
+            dest::core::ShapeResidual r = dest::core::ShapeResidual::Zero(2, 3);
+            f.predict(intensities, r);
+            REQUIRE(r == expected);
+
+            dest::core::ShapeResidual rb = dest::core::ShapeResidual::Zero(2, 3);
+            fb.predict(intensities, rb);
+            REQUIRE(rb == expected);
+
+            REQUIRE(batchResiduals.col(k) == Eigen::Map<Eigen::VectorXf>(expected.data(), 6));
+        }
+    }
+}
+
+TEST_CASE("forest-quantized-leaves")
+{
+    std::vector<dest::core::Tree> trees;
+    for (int i = 0; i < 50; ++i) {
+        trees.push_back(createFullTree(4));
+    }
+
+    dest::core::Forest f, f16, fh;
+    f.build(trees, 0.1f);
+    f16.build(trees, 0.1f, dest::core::ForestEvaluation_TreeWalk, dest::core::LeafEncoding_Int16);
+    fh.build(trees, 0.1f, dest::core::ForestEvaluation_BitVector, dest::core::LeafEncoding_Float16);
+    REQUIRE(f16.leafEncoding() == dest::core::LeafEncoding_Int16);
+    REQUIRE(fh.leafEncoding() == dest::core::LeafEncoding_Float16);
+
+    for (int k = 0; k < 20; ++k) {
+        dest::core::PixelIntensities intensities = dest::core::PixelIntensities::Random(8) * 64.f;
+
+        dest::core::ShapeResidual r = dest::core::ShapeResidual::Zero(2, 3);
+        dest::core::ShapeResidual r16 = dest::core::ShapeResidual::Zero(2, 3);
+        dest::core::ShapeResidual rh = dest::core::ShapeResidual::Zero(2, 3);
+        f.predict(intensities, r);
+        f16.predict(intensities, r16);
+        fh.predict(intensities, rh);
+
+        // Leaves are within [-0.1, 0.1], 50 trees accumulate rounding errors.
+        REQUIRE((r16 - r).cwiseAbs().maxCoeff() < 1e-4f);
+        REQUIRE((rh - r).cwiseAbs().maxCoeff() < 1e-3f);
+    }
+}
+
+TEST_CASE("forest-fixed-point")
+{
+    std::vector<dest::core::Tree> trees;
+    for (int i = 0; i < 20; ++i) {
+        trees.push_back(createFullTree(5));
+    }
+
+    dest::core::Forest f, ff;
+    f.build(trees, 0.1f);
+    ff.build(trees, 0.1f, dest::core::ForestEvaluation_FixedPoint);
+    REQUIRE(ff.evaluation() == dest::core::ForestEvaluation_FixedPoint);
+
+    const float one = static_cast<float>(1 << dest::core::FixedIntensityFractionBits);
+
+    dest::core::FixedPixelIntensitiesMatrix batchIntensities(8, 20);
+    Eigen::MatrixXf batchResiduals = Eigen::MatrixXf::Zero(6, 20);
+    for (int k = 0; k < 20; ++k) {
+        for (int i = 0; i < 8; ++i) {
+            batchIntensities(i, k) = static_cast<short>(rand() % (255 * 128));
+        }
+    }
+    ff.predict(batchIntensities, batchResiduals);
+
+    for (int k = 0; k < 20; ++k) {
+        // Fixed point intensities are exactly representable as float, so split tests agree.
+        dest::core::FixedPixelIntensities fixedIntensities = batchIntensities.col(k).transpose();
+        dest::core::PixelIntensities intensities = fixedIntensities.cast<float>() / one;
+
+        dest::core::ShapeResidual expected = dest::core::ShapeResidual::Zero(2, 3);
+        f.predict(intensities, expected);
+
+        dest::core::ShapeResidual r = dest::core::ShapeResidual::Zero(2, 3);
+        ff.predict(fixedIntensities, r);
+
+        REQUIRE(r == expected);
+        REQUIRE(batchResiduals.col(k) == Eigen::Map<Eigen::VectorXf>(expected.data(), 6));
+    }
+}
+
+TEST_CASE("forest-landmark-counts")
+{
+    // Covers specializations for common landmark counts.
+    const int counts[] = { 5, 58, 68, 74 };
+    for (int c = 0; c < 4; ++c) {
+        const int numLandmarks = counts[c];
+
+        std::vector<dest::core::Tree> trees;
+        for (int i = 0; i < 30; ++i) {
+            trees.push_back(createFullTree(4, numLandmarks));
+        }
+
+        dest::core::Forest f;
+        f.build(trees, 0.1f);
+
+        for (int k = 0; k < 10; ++k) {
+            dest::core::PixelIntensities intensities = dest::core::PixelIntensities::Random(8) * 64.f;
+
+            dest::core::ShapeResidual expected = dest::core::ShapeResidual::Zero(2, numLandmarks);
+            for (size_t i = 0; i < trees.size(); ++i) {
+                trees[i].predict(intensities, expected, 0.1f);
+            }
+
+            dest::core::ShapeResidual r = dest::core::ShapeResidual::Zero(2, numLandmarks);
+            f.predict(intensities, r);
+            REQUIRE(r == expected);
+        }
+    }
+}
+
+TEST_CASE("forest-max-trees")
+{
+    std::vector<dest::core::Tree> trees;
+    for (int i = 0; i < 300; ++i) {
+        trees.push_back(createFullTree(5));
+    }
+
+    dest::core::Forest f, fb;
+    f.build(trees, 0.25f);
+    fb.build(trees, 0.25f, dest::core::ForestEvaluation_BitVector);
+
+    // Limits below, at and across block boundaries.
+    const int limits[] = { 1, 100, 256, 260, 300, 1000 };
+
+    Eigen::MatrixXf batchIntensities = Eigen::MatrixXf::Random(8, 5) * 64.f;
+
+    for (int l = 0; l < 6; ++l) {
+        const int numUsed = std::min<int>(limits[l], 300);
+
+        Eigen::MatrixXf batchResiduals = Eigen::MatrixXf::Zero(6, 5);
+        fb.predict(batchIntensities, batchResiduals, limits[l]);
+
+        for (int k = 0; k < 5; ++k) {
+            dest::core::PixelIntensities intensities = batchIntensities.col(k).transpose();
+
+            dest::core::ShapeResidual expected = dest::core::ShapeResidual::Zero(2, 3);
+            for (int i = 0; i < numUsed; ++i) {
+                trees[i].predict(intensities, expected, 0.25f);
+            }
+
+            dest::core::ShapeResidual r = dest::core::ShapeResidual::Zero(2, 3);
+            f.predict(intensities, r, limits[l]);
+            REQUIRE(r == expected);
+
+            dest::core::ShapeResidual rb = dest::core::ShapeResidual::Zero(2, 3);
+            fb.predict(intensities, rb, limits[l]);
+            REQUIRE(rb == expected);
+
+            REQUIRE(batchResiduals.col(k) == Eigen::Map<Eigen::VectorXf>(expected.data(), 6));
+        }
+    }
+}
+
+TEST_CASE("forest-compressed-leaves")
+{
+    std::vector<dest::core::Tree> trees;
+    for (int i = 0; i < 20; ++i) {
+        trees.push_back(createFullTree(4));
+    }
+
+    // Orthonormal basis of a two dimensional subspace of residuals.
+    Eigen::JacobiSVD<Eigen::MatrixXf, Eigen::NoQRPreconditioner> svd(Eigen::MatrixXf::Random(6, 6), Eigen::ComputeFullU);
+    Eigen::MatrixXf q = svd.matrixU();
+    Eigen::MatrixXf basis = q.leftCols(2);
+
+    dest::core::Forest f, fc, ff;
+    f.build(trees, 0.5f);
+    fc.build(trees, 0.5f, dest::core::ForestEvaluation_BitVector, dest::core::LeafEncoding_Float32, &basis);
+    ff.build(trees, 0.5f, dest::core::ForestEvaluation_TreeWalk, dest::core::LeafEncoding_Float32, &q);
+    REQUIRE(f.numLeafComponents() == 0);
+    REQUIRE(fc.numLeafComponents() == 2);
+
+    Eigen::MatrixXf batchIntensities = Eigen::MatrixXf::Random(8, 5) * 64.f;
+    Eigen::MatrixXf batchResiduals = Eigen::MatrixXf::Zero(6, 5);
+    fc.predict(batchIntensities, batchResiduals);
+
+    for (int k = 0; k < 5; ++k) {
+        dest::core::PixelIntensities intensities = batchIntensities.col(k).transpose();
+
+        dest::core::ShapeResidual expected = dest::core::ShapeResidual::Zero(2, 3);
+        f.predict(intensities, expected);
+        Eigen::Map<Eigen::VectorXf> e(expected.data(), 6);
+
+        // Compressed prediction is the projection of the full prediction.
+        dest::core::ShapeResidual r = dest::core::ShapeResidual::Zero(2, 3);
+        fc.predict(intensities, r);
+        Eigen::Map<Eigen::VectorXf> v(r.data(), 6);
+        REQUIRE(v.isApprox(basis * (basis.transpose() * e), 1e-4f));
+        REQUIRE(batchResiduals.col(k).isApprox(v));
+
+        // A complete basis is lossless.
+        dest::core::ShapeResidual rf = dest::core::ShapeResidual::Zero(2, 3);
+        ff.predict(intensities, rf);
+        REQUIRE(rf.isApprox(expected, 1e-4f));
+    }
+}
+
+TEST_CASE("tree-remap-pixel-indices")
+{
+    dest::core::Tree t = createTree(1);
+    dest::core::Tree full = createFullTree(5);
+
+    // Reverse order of 8 pixels.
+    Eigen::VectorXi newIndex(8);
+    for (int i = 0; i < 8; ++i) {
+        newIndex(i) = 7 - i;
+    }
+
+    dest::core::Tree tr = t, fullr = full;
+    tr.remapPixelIndices(newIndex);
+    fullr.remapPixelIndices(newIndex);
+
+    for (int k = 0; k < 20; ++k) {
+        dest::core::PixelIntensities intensities = dest::core::PixelIntensities::Random(8) * 64.f;
+        dest::core::PixelIntensities permuted = intensities.reverse();
+
+        REQUIRE(tr.predictLeaf(permuted) == t.predictLeaf(intensities));
+        REQUIRE(fullr.predictLeaf(permuted) == full.predictLeaf(intensities));
+    }
+}
+
+TEST_CASE("forest-simd-levels")
+{
+    // Every SIMD kernel has to reproduce the portable tree walk and accumulation exactly.
+    // Tree and landmark counts are chosen to leave remainders after full SIMD blocks.
+    const int counts[] = { 5, 68, 70 };
+    for (int c = 0; c < 3; ++c) {
+        std::vector<dest::core::Tree> trees;
+        for (int i = 0; i < 301; ++i) {
+            trees.push_back(createFullTree(5, counts[c]));
+        }
+
+        dest::core::Forest f, ff;
+        f.build(trees, 0.1f);
+        ff.build(trees, 0.1f, dest::core::ForestEvaluation_FixedPoint);
+
+        for (int k = 0; k < 5; ++k) {
+            dest::core::PixelIntensities intensities = dest::core::PixelIntensities::Random(8) * 64.f;
+            dest::core::FixedPixelIntensities fixedIntensities = (intensities * static_cast<float>(1 << dest::core::FixedIntensityFractionBits)).cast<short>();
+
+            dest::util::setMaxSimdLevel(dest::util::SimdLevel_None);
+            dest::core::ShapeResidual expected = dest::core::ShapeResidual::Zero(2, counts[c]);
+            f.predict(intensities, expected);
+            dest::core::ShapeResidual expectedFixed = dest::core::ShapeResidual::Zero(2, counts[c]);
+            ff.predict(fixedIntensities, expectedFixed);
+
+            const dest::util::SimdLevel levels[] = { dest::util::SimdLevel_SSE2, dest::util::SimdLevel_AVX2, dest::util::SimdLevel_AVX512 };
+            for (int l = 0; l < 3; ++l) {
+                dest::util::setMaxSimdLevel(levels[l]);
+                dest::core::ShapeResidual r = dest::core::ShapeResidual::Zero(2, counts[c]);
+                f.predict(intensities, r);
+                REQUIRE(r == expected);
+
+                dest::core::ShapeResidual rf = dest::core::ShapeResidual::Zero(2, counts[c]);
+                ff.predict(fixedIntensities, rf);
+                REQUIRE(rf == expectedFixed);
+            }
+        }
+    }
+
+    dest::util::setMaxSimdLevel(dest::util::SimdLevel_AVX512);
+}
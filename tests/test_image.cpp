@@ -11,6 +11,9 @@
 #include "catch.hpp"
 
 #include <dest/core/image.h>
+#include <dest/util/cpu.h>
+#include <cmath>
+#include <algorithm>
 
 TEST_CASE("image-readpixels")
 {
@@ -30,4 +33,154 @@ TEST_CASE("image-readpixels")
     
     REQUIRE(intensities.isApprox(expected));
 
-}
\ No newline at end of file
+}
+
+TEST_CASE("image-readpixels-strided")
+{
+    // Image of 2x2 pixels embedded in rows of 5 bytes.
+    unsigned char buffer[] = {
+        0, 64, 9, 9, 9,
+        128, 255, 9, 9, 9
+    };
+    
+    dest::core::MappedImage img(buffer, 2, 2, Eigen::OuterStride<Eigen::Dynamic>(5));
+    Eigen::Ref<const dest::core::Image> ref(img);
+    REQUIRE(ref.data() == buffer);
+    
+    dest::core::PixelCoordinates coords(2, 6);
+    coords << -1.f, 0.f, 0.f, 0.5f, 0.5f, 2.f,
+              -1.f, 0.f, 0.5f, 0.0f, 0.5f, 2.f;
+    
+    dest::core::PixelIntensities expected(6);
+    expected << 0.f, 0.f, 64.f, 32.f, 111.75f, 255.f;
+    
+    dest::core::PixelIntensities intensities;
+    dest::core::readImage(img, coords, intensities);
+    
+    REQUIRE(intensities.isApprox(expected));
+}
+
+
+TEST_CASE("image-readpixels-many")
+{
+    // Exceeds SIMD block sizes and samples close to and beyond image borders.
+    dest::core::Image img = dest::core::Image::Random(37, 53);
+    dest::core::PixelCoordinates coords = dest::core::PixelCoordinates::Random(2, 1001);
+    coords.row(0) = (coords.row(0).array() + 1.f) * 30.f - 2.f;
+    coords.row(1) = (coords.row(1).array() + 1.f) * 21.f - 2.f;
+    
+    dest::core::PixelIntensities intensities;
+    dest::core::readImage(img, coords, intensities);
+    REQUIRE(intensities.size() == coords.cols());
+    
+    for (int i = 0; i < coords.cols(); ++i) {
+        const float x = coords(0, i);
+        const float y = coords(1, i);
+        const int ix = static_cast<int>(std::floor(x));
+        const int iy = static_cast<int>(std::floor(y));
+        const int x0 = std::min<int>(52, std::max<int>(0, ix));
+        const int x1 = std::min<int>(52, std::max<int>(0, ix + 1));
+        const int y0 = std::min<int>(36, std::max<int>(0, iy));
+        const int y1 = std::min<int>(36, std::max<int>(0, iy + 1));
+        const float a = x - (float)ix;
+        const float b = y - (float)iy;
+        
+        const float expected = (img(y0, x0) * (1.f - a) + img(y0, x1) * a) * (1.f - b) +
+                               (img(y1, x0) * (1.f - a) + img(y1, x1) * a) * b;
+        
+        REQUIRE(intensities(i) == Approx(expected));
+    }
+}
+
+TEST_CASE("image-readpixels-fixed")
+{
+    dest::core::Image img = dest::core::Image::Random(37, 53);
+    dest::core::PixelCoordinates coords = dest::core::PixelCoordinates::Random(2, 500);
+    coords.row(0) = (coords.row(0).array() + 1.f) * 30.f - 2.f;
+    coords.row(1) = (coords.row(1).array() + 1.f) * 21.f - 2.f;
+    
+    dest::core::PixelIntensities intensities;
+    dest::core::FixedPixelIntensities fixedIntensities;
+    dest::core::readImage(img, coords, intensities);
+    dest::core::readImageFixed(img, coords, fixedIntensities);
+    REQUIRE(fixedIntensities.size() == coords.cols());
+    
+    const float one = static_cast<float>(1 << dest::core::FixedIntensityFractionBits);
+    for (int i = 0; i < coords.cols(); ++i) {
+        // Each rounded weight contributes at most half a fixed point step times the intensity range.
+        REQUIRE(std::abs(fixedIntensities(i) / one - intensities(i)) <= 255.f / one + 1.f / one);
+    }
+
+    // Integer coordinates are sampled exactly.
+    dest::core::PixelCoordinates integral(2, 2);
+    integral << 3.f, 52.f, 
+                7.f, 36.f;
+    dest::core::readImageFixed(img, integral, fixedIntensities);
+    REQUIRE(fixedIntensities(0) == img(7, 3) * one);
+    REQUIRE(fixedIntensities(1) == img(36, 52) * one);
+}
+
+TEST_CASE("image-readpixels-anchored")
+{
+    dest::core::Image img = dest::core::Image::Random(37, 53);
+
+    dest::core::PixelCoordinates anchors(2, 3);
+    anchors << 10.f, 30.f, 45.f,
+               5.f, 20.f, 33.f;
+
+    // Span multiple blocks and leave a remainder.
+    dest::core::PixelCoordinates offsets = dest::core::PixelCoordinates::Random(2, 203) * 8.f;
+    Eigen::VectorXi anchorIds(offsets.cols());
+    for (int i = 0; i < anchorIds.size(); ++i) {
+        anchorIds(i) = i % 3;
+    }
+
+    Eigen::Matrix2f linear;
+    linear << 0.9f, -0.3f,
+              0.3f, 0.9f;
+
+    dest::core::PixelCoordinates coords(2, offsets.cols());
+    for (int i = 0; i < coords.cols(); ++i) {
+        coords(0, i) = linear(0, 0) * offsets(0, i) + linear(0, 1) * offsets(1, i) + anchors(0, anchorIds(i));
+        coords(1, i) = linear(1, 0) * offsets(0, i) + linear(1, 1) * offsets(1, i) + anchors(1, anchorIds(i));
+    }
+
+    dest::core::PixelIntensities expected, intensities;
+    dest::core::readImage(img, coords, expected);
+    dest::core::readImage(img, linear, offsets, anchorIds, anchors, intensities);
+    REQUIRE(intensities == expected);
+
+    dest::core::FixedPixelIntensities expectedFixed, fixedIntensities;
+    dest::core::readImageFixed(img, coords, expectedFixed);
+    dest::core::readImageFixed(img, linear, offsets, anchorIds, anchors, fixedIntensities);
+    REQUIRE(fixedIntensities == expectedFixed);
+}
+
+TEST_CASE("image-readpixels-simd-levels")
+{
+    // Every SIMD kernel has to reproduce the portable sampler exactly.
+    dest::core::Image img = dest::core::Image::Random(37, 53);
+    dest::core::PixelCoordinates coords = dest::core::PixelCoordinates::Random(2, 1001);
+    coords.row(0) = (coords.row(0).array() + 1.f) * 30.f - 2.f;
+    coords.row(1) = (coords.row(1).array() + 1.f) * 21.f - 2.f;
+    
+    dest::util::setMaxSimdLevel(dest::util::SimdLevel_None);
+    dest::core::PixelIntensities expected;
+    dest::core::readImage(img, coords, expected);
+    dest::core::FixedPixelIntensities expectedFixed;
+    dest::core::readImageFixed(img, coords, expectedFixed);
+    
+    const dest::util::SimdLevel levels[] = { dest::util::SimdLevel_SSE2, dest::util::SimdLevel_AVX2, dest::util::SimdLevel_AVX512 };
+    for (int l = 0; l < 3; ++l) {
+        dest::util::setMaxSimdLevel(levels[l]);
+        dest::core::PixelIntensities intensities;
+        dest::core::readImage(img, coords, intensities);
+        REQUIRE(intensities == expected);
+
+        dest::core::FixedPixelIntensities fixedIntensities;
+        dest::core::readImageFixed(img, coords, fixedIntensities);
+        REQUIRE(fixedIntensities == expectedFixed);
+    }
+    
+    dest::util::setMaxSimdLevel(dest::util::SimdLevel_AVX512);
+}
@@ -11,7 +11,9 @@ of the BSD license.See the LICENSE file for details.
 #include "catch.hpp"
 
 #include <dest/core/shape.h>
+#include <dest/core/forest.h>
 #include <dest/io/matrix_io.h>
+#include <limits>
 
 TEST_CASE("matrix")
 {
@@ -19,4 +21,45 @@ TEST_CASE("matrix")
     
     flatbuffers::FlatBufferBuilder fbb;
     auto off = dest::io::toFbs(fbb, s);
-}
\ No newline at end of file
+}
+
+TEST_CASE("matrix-quantized")
+{
+    Eigen::MatrixXf m = Eigen::MatrixXf::Random(6, 20) * 0.05f;
+    m(3, 7) = 0.f;
+    const float maxAbs = m.cwiseAbs().maxCoeff();
+
+    for (int type = dest::io::Int16; type <= dest::io::Float16; ++type) {
+        Eigen::MatrixXf v = m;
+        const float scale = dest::core::quantizeLeaves(v, type == dest::io::Int16 ? dest::core::LeafEncoding_Int16 : dest::core::LeafEncoding_Float16);
+
+        flatbuffers::FlatBufferBuilder fbb;
+        fbb.Finish(dest::io::toFbs(fbb, v, static_cast<dest::io::QuantizationType>(type), scale));
+
+        const dest::io::QuantizedMatrix *q = flatbuffers::GetRoot<dest::io::QuantizedMatrix>(fbb.GetBufferPointer());
+        REQUIRE(q->type() == type);
+
+        Eigen::MatrixXf r;
+        dest::io::fromFbs(*q, r);
+
+        REQUIRE(r.rows() == m.rows());
+        REQUIRE(r.cols() == m.cols());
+        REQUIRE(r(3, 7) == 0.f);
+        REQUIRE(r == v);
+REQUIRE((r - m).cwiseAbs().maxCoeff() <= maxAbs * 1e-3f);
+    }
+}
+
+TEST_CASE("float16")
+{
+    const float exact[] = { 0.f, -0.f, 1.f, -2.5f, 65504.f, 6.103515625e-05f, 5.9604644775390625e-08f };
+    for (size_t i = 0; i < sizeof(exact) / sizeof(float); ++i) {
+        const uint16_t h = dest::util::toFloat16(exact[i]);
+        REQUIRE(dest::util::fromFloat16(h) == exact[i]);
+        REQUIRE(dest::util::fromFloat16Finite(h) == exact[i]);
+    }
+
+    REQUIRE(dest::util::toFloat16(1e6f) == 0x7C00);
+    REQUIRE(dest::util::fromFloat16(0x7C00) == std::numeric_limits<float>::infinity());
+    REQUIRE(dest::util::toFloat16(1.f + 1.f / 4096.f) == dest::util::toFloat16(1.f));
+}
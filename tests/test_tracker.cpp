@@ -0,0 +1,288 @@
+/**
+This file is part of Deformable Shape Tracking (DEST).
+
+Copyright(C) 2015/2016 Christoph Heindl
+All rights reserved.
+
+This software may be modified and distributed under the terms
+of the BSD license.See the LICENSE file for details.
+*/
+
+#include "catch.hpp"
+#include "fixture.h"
+
+#include <dest/core/config.h>
+#include <dest/core/tracker.h>
+#include <dest/core/parallel_aligner.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+    using fixture::createInputData;
+    using fixture::trainTracker;
+
+    const dest::core::Tracker &trainedTracker() {
+        static dest::core::Tracker t;
+        static bool trained = false;
+
+        if (!trained) {
+            trainTracker(t, 0);
+            trained = true;
+        }
+
+        return t;
+    }
+}
+
+TEST_CASE("tracker-parallel-align")
+{
+    const dest::core::Tracker &t = trainedTracker();
+
+    dest::core::InputData input;
+    createInputData(input, 10, 7);
+
+    std::vector<dest::core::AlignmentJob> jobs;
+    for (size_t i = 0; i < input.images.size(); ++i) {
+        // Vary the number of shapes per job
+        std::vector<dest::core::ShapeTransform> shapeToImage(i % 3 + 1, input.shapeToImage[i]);
+        jobs.push_back(dest::core::AlignmentJob(input.images[i], shapeToImage));
+    }
+
+    std::vector< std::vector<dest::core::Shape> > results;
+    dest::core::ParallelAligner aligner(t, 3);
+    REQUIRE(aligner.numThreads() == 3);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        aligner.align(jobs, results);
+        REQUIRE(results.size() == jobs.size());
+
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            dest::core::Shape expected = t.predict(input.images[i], input.shapeToImage[i]);
+            REQUIRE(results[i].size() == jobs[i].shapeToImage.size());
+            for (size_t j = 0; j < results[i].size(); ++j) {
+                REQUIRE(results[i][j] == expected);
+            }
+        }
+    }
+
+    // Calls from several threads on the same aligner are serialized.
+    std::vector< std::vector< std::vector<dest::core::Shape> > > threadResults(3);
+    std::vector<std::thread> callers;
+    for (size_t k = 0; k < threadResults.size(); ++k) {
+        callers.push_back(std::thread([&aligner, &jobs, &threadResults, k]() { aligner.align(jobs, threadResults[k]); }));
+    }
+    for (size_t k = 0; k < callers.size(); ++k) {
+        callers[k].join();
+    }
+    for (size_t k = 0; k < threadResults.size(); ++k) {
+        REQUIRE(threadResults[k] == results);
+    }
+}
+
+TEST_CASE("tracker-quantized-leaves")
+{
+    dest::core::Tracker t = trainedTracker();
+
+    dest::core::InputData input;
+    createInputData(input, 5, 9);
+
+    for (int e = dest::core::LeafEncoding_Int16; e <= dest::core::LeafEncoding_Float16; ++e) {
+        dest::core::Tracker q = t;
+        q.setLeafEncoding(static_cast<dest::core::LeafEncoding>(e));
+
+        flatbuffers::FlatBufferBuilder fbb;
+        dest::io::FinishTrackerBuffer(fbb, q.save(fbb));
+
+        dest::core::Tracker loaded;
+        loaded.load(*dest::io::GetTracker(fbb.GetBufferPointer()));
+
+        for (size_t i = 0; i < input.images.size(); ++i) {
+            dest::core::Shape expected = t.predict(input.images[i], input.shapeToImage[i]);
+            dest::core::Shape s = loaded.predict(input.images[i], input.shapeToImage[i]);
+            REQUIRE((s - expected).cwiseAbs().maxCoeff() < 0.05f);
+
+            // Leaves are quantized once, saving does not change predictions.
+            REQUIRE(s == q.predict(input.images[i], input.shapeToImage[i]));
+        }
+
+        // Saving a reloaded tracker reproduces the file.
+        flatbuffers::FlatBufferBuilder fbb2;
+        dest::io::FinishTrackerBuffer(fbb2, loaded.save(fbb2));
+        REQUIRE(fbb2.GetSize() == fbb.GetSize());
+        REQUIRE(std::memcmp(fbb2.GetBufferPointer(), fbb.GetBufferPointer(), fbb.GetSize()) == 0);
+    }
+}
+
+TEST_CASE("tracker-early-exit")
+{
+    const dest::core::Tracker &t = trainedTracker();
+
+    dest::core::InputData input;
+    createInputData(input, 5, 11);
+
+    dest::core::PredictionContext ctx = t.createPredictionContext();
+    dest::core::PredictOptions opts;
+    dest::core::Shape s;
+
+    for (size_t i = 0; i < input.images.size(); ++i) {
+        std::vector<dest::core::Shape> steps;
+        dest::core::Shape expected = t.predict(input.images[i], input.shapeToImage[i], &steps);
+        REQUIRE(steps.size() == 4);
+
+        // Disabled by default, all stages are run.
+        opts.convergenceThreshold = 0.f;
+        t.predict(input.images[i], input.shapeToImage[i], opts, ctx, s);
+        REQUIRE(ctx.numStages == 3);
+        REQUIRE(s == expected);
+
+        // Any update is considered converged, only the first stage is run.
+        opts.convergenceThreshold = 1e6f;
+        t.predict(input.images[i], input.shapeToImage[i], opts, ctx, s);
+        REQUIRE(ctx.numStages == 1);
+        REQUIRE(s.isApprox(steps[1]));
+    }
+
+    std::vector<dest::core::Shape> results;
+    t.predictBatch(input.images[0], input.shapeToImage, opts, ctx, results);
+    REQUIRE(ctx.numStages == 1);
+    for (size_t i = 0; i < results.size(); ++i) {
+        dest::core::Shape expected;
+        t.predict(input.images[0], input.shapeToImage[i], opts, ctx, expected);
+        REQUIRE(results[i] == expected);
+    }
+
+    // Shapes converging after different numbers of stages match per shape prediction.
+    const float thresholds[] = { 1e-3f, 3e-3f, 1e-2f, 3e-2f, 1e-1f };
+    bool mixed = false;
+    for (size_t k = 0; k < sizeof(thresholds) / sizeof(float); ++k) {
+        opts.convergenceThreshold = thresholds[k];
+        t.predictBatch(input.images[0], input.shapeToImage, opts, ctx, results);
+        const int batchStages = ctx.numStages;
+
+        int maxStages = 0;
+        for (size_t i = 0; i < results.size(); ++i) {
+            dest::core::Shape expected;
+            t.predict(input.images[0], input.shapeToImage[i], opts, ctx, expected);
+            REQUIRE(results[i] == expected);
+
+            mixed = mixed || (i > 0 && ctx.numStages != maxStages);
+            maxStages = std::max<int>(maxStages, ctx.numStages);
+        }
+        REQUIRE(batchStages == maxStages);
+    }
+    REQUIRE(mixed);
+}
+
+TEST_CASE("tracker-budgeted-prediction")
+{
+    const dest::core::Tracker &t = trainedTracker();
+
+    dest::core::InputData input;
+    createInputData(input, 5, 13);
+
+    dest::core::PredictionContext ctx = t.createPredictionContext();
+    dest::core::PredictOptions opts;
+    dest::core::Shape s, all;
+
+    for (size_t i = 0; i < input.images.size(); ++i) {
+        std::vector<dest::core::Shape> steps;
+        t.predict(input.images[i], input.shapeToImage[i], &steps);
+
+        // Truncating the cascade yields the intermediate result of the full cascade.
+        opts = dest::core::PredictOptions();
+        opts.maxStages = 2;
+        t.predict(input.images[i], input.shapeToImage[i], opts, ctx, s);
+        REQUIRE(ctx.numStages == 2);
+        REQUIRE(s.isApprox(steps[2]));
+
+        // Limits beyond the trained size use the full model.
+        opts.maxStages = 10;
+        opts.maxTreesPerStage = 100;
+        t.predict(input.images[i], input.shapeToImage[i], opts, ctx, s);
+        REQUIRE(ctx.numStages == 3);
+        REQUIRE(s == steps[3]);
+
+        opts.maxTreesPerStage = 5;
+        t.predict(input.images[i], input.shapeToImage[i], opts, ctx, s);
+        REQUIRE(s != steps[3]);
+
+        std::vector<dest::core::Shape> results;
+        t.predictBatch(input.images[i], std::vector<dest::core::ShapeTransform>(2, input.shapeToImage[i]), opts, ctx, results);
+        REQUIRE(results[0] == s);
+        REQUIRE(results[1] == s);
+    }
+}
+
+TEST_CASE("tracker-compressed-leaves")
+{
+    const dest::core::Tracker &t = trainedTracker();
+
+    dest::core::InputData input;
+    createInputData(input, 5, 17);
+
+    dest::core::Tracker c = t;
+    c.compressLeaves(6);
+
+    for (int e = dest::core::LeafEncoding_Float32; e <= dest::core::LeafEncoding_Float16; ++e) {
+        c.setLeafEncoding(static_cast<dest::core::LeafEncoding>(e));
+
+        flatbuffers::FlatBufferBuilder fbb;
+        dest::io::FinishTrackerBuffer(fbb, c.save(fbb));
+
+        dest::core::Tracker loaded;
+        loaded.load(*dest::io::GetTracker(fbb.GetBufferPointer()));
+
+        for (size_t i = 0; i < input.images.size(); ++i) {
+            dest::core::Shape expected = t.predict(input.images[i], input.shapeToImage[i]);
+            dest::core::Shape compressed = c.predict(input.images[i], input.shapeToImage[i]);
+            dest::core::Shape s = loaded.predict(input.images[i], input.shapeToImage[i]);
+
+            // Leaves are compressed and quantized once, saving does not change predictions.
+            REQUIRE(s == compressed);
+
+            // Six of sixteen components keep the shape within a fraction of a pixel.
+            REQUIRE((s - expected).cwiseAbs().maxCoeff() < 0.5f);
+        }
+
+        // Saving a reloaded tracker reproduces the file.
+        flatbuffers::FlatBufferBuilder fbb2;
+        dest::io::FinishTrackerBuffer(fbb2, loaded.save(fbb2));
+        REQUIRE(fbb2.GetSize() == fbb.GetSize());
+        REQUIRE(std::memcmp(fbb2.GetBufferPointer(), fbb.GetBufferPointer(), fbb.GetSize()) == 0);
+    }
+
+    // A complete basis reproduces the uncompressed tracker.
+    dest::core::Tracker full = t;
+    full.compressLeaves(16);
+    for (size_t i = 0; i < input.images.size(); ++i) {
+        dest::core::Shape expected = t.predict(input.images[i], input.shapeToImage[i]);
+        dest::core::Shape s = full.predict(input.images[i], input.shapeToImage[i]);
+        REQUIRE((s - expected).cwiseAbs().maxCoeff() < 0.01f);
+    }
+}
+
+#ifdef DEST_WITH_OPENMP
+// Without OpenMP the number of training threads is ignored.
+TEST_CASE("tracker-training-threads")
+{
+    // Training results must not depend on the number of threads. Input shapes are
+    // perturbed using rand(), so both trackers are trained from the same seed.
+    dest::core::Tracker expected;
+    std::srand(42);
+    trainTracker(expected, 1);
+
+    dest::core::Tracker t;
+    std::srand(42);
+    trainTracker(t, 3);
+
+    dest::core::InputData input;
+    createInputData(input, 5, 7);
+
+    for (size_t i = 0; i < input.images.size(); ++i) {
+        REQUIRE(t.predict(input.images[i], input.shapeToImage[i]) == expected.predict(input.images[i], input.shapeToImage[i]));
+    }
+}
+#endif
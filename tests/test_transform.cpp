@@ -67,4 +67,44 @@ TEST_CASE("similarity-transform-between-rects")
 
     r = s.matrix() * r.colwise().homogeneous();
     REQUIRE(r.isApprox(n));
-}
\ No newline at end of file
+}
+
+TEST_CASE("similarity-transform-least-squares")
+{
+    Eigen::AffineCompact2f t;
+    t = Eigen::Translation2f(3.f, -2.f) * Eigen::Rotation2Df(-2.4f) * Eigen::Scaling(0.6f);
+
+    dest::core::Shape from = dest::core::Shape::Random(2, 68);
+    dest::core::Shape to = t.matrix() * from.colwise().homogeneous();
+    to += 0.01f * dest::core::Shape::Random(2, 68);
+
+    // Reference solution by Umeyama's method.
+    Eigen::Matrix3f expected = Eigen::umeyama(from, to, true);
+    Eigen::AffineCompact2f s = dest::core::estimateSimilarityTransform(from, to);
+
+    REQUIRE(s.matrix().isApprox(expected.topRows(2), 1e-4f));
+}
+
+TEST_CASE("similarity-transform-precentered")
+{
+    Eigen::AffineCompact2f t;
+    t = Eigen::Translation2f(1.f, 1.f) * Eigen::Rotation2Df(0.8f) * Eigen::Scaling(1.3f);
+
+    dest::core::Shape from = dest::core::Shape::Random(2, 20);
+    dest::core::Shape to = t.matrix() * from.colwise().homogeneous();
+    to += 0.05f * dest::core::Shape::Random(2, 20);
+
+    Eigen::Vector2f meanFrom = from.rowwise().mean();
+    dest::core::Shape centeredFrom = from.colwise() - meanFrom;
+
+    Eigen::AffineCompact2f s = dest::core::estimateSimilarityTransform(from, to);
+    Eigen::AffineCompact2f f = dest::core::estimateSimilarityTransform(centeredFrom, meanFrom, centeredFrom.squaredNorm(), to);
+
+    REQUIRE(f.isApprox(s, 1e-5f));
+
+    // Degenerate source shape falls back to a translation.
+    dest::core::Shape point = dest::core::Shape::Zero(2, 20);
+    f = dest::core::estimateSimilarityTransform(point, Eigen::Vector2f(2.f, 1.f), 0.f, to);
+    REQUIRE(f.linear().isIdentity());
+    REQUIRE(f.translation().isApprox(to.rowwise().mean() - Eigen::Vector2f(2.f, 1.f)));
+}